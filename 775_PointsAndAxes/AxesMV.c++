@@ -10,8 +10,6 @@ int AxesMV::numInstances = 0;
 GLuint AxesMV::shaderProgram = 0;
 GLint AxesMV::pvaLoc_mcPosition = -1;
 
-GLint AxesMV::ppuLoc_mc_ec = -1;
-GLint AxesMV::ppuLoc_ec_lds = -1;
 GLint AxesMV::ppuLoc_color = -1;
 
 AxesMV::AxesMV(double xminIn, double xmaxIn, double dx, double fx,
@@ -181,8 +179,9 @@ void AxesMV::fetchGLSLVariableLocations()
 	{
 		pvaLoc_mcPosition = pvAttribLocation(shaderProgram, "mcPosition");
 		ppuLoc_color = ppUniformLocation(shaderProgram, "color");
-		ppuLoc_mc_ec = ppUniformLocation(shaderProgram, "mc_ec");
-		ppuLoc_ec_lds = ppUniformLocation(shaderProgram, "ec_lds");
+		bindUniformBlock(shaderProgram, "ViewTransformation", VIEW_BLOCK_BINDING);
+		// Make axes black:
+		glProgramUniform4f(shaderProgram, ppuLoc_color, 0.0, 0.0, 0.0, 1.0);
 	}
 }
 
@@ -199,27 +198,10 @@ void AxesMV::getMCBoundingBox(double* xyzLimits) const
 
 void AxesMV::render()
 {
-	// save the current GLSL program in use
-	GLint pgm;
-	glGetIntegerv(GL_CURRENT_PROGRAM, &pgm);
-	// draw the triangles using our vertex and fragment shaders
+	// (the view is in the ViewTransformation block; the color never changes)
 	glUseProgram(shaderProgram);
-
-	// Retrieve and establish view mapping
-	cryph::Matrix4x4 mc_ec, ec_lds;
-	float buf[16];
-	ModelView::getMatrices(mc_ec, ec_lds);
-	glUniformMatrix4fv(ppuLoc_mc_ec, 1, false, mc_ec.extractColMajor(buf));
-	glUniformMatrix4fv(ppuLoc_ec_lds, 1, false, ec_lds.extractColMajor(buf));
-
 	glBindVertexArray(vao[0]);
-
-	// Make axes black:
-	glUniform4f(ppuLoc_color, 0.0, 0.0, 0.0, 1.0);
 	glDrawArrays(GL_LINES, 0, nPoints);
-
-	// restore the previous program
-	glUseProgram(pgm);
 }
 
 void AxesMV::validateData(double& dx, double& fx, double& dy, double& fy, double&dz, double& fz)
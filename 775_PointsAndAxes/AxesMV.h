@@ -39,7 +39,7 @@ private:
 	static int numInstances;
 	static GLuint shaderProgram;
 	static GLint pvaLoc_mcPosition;
-	static GLint ppuLoc_color, ppuLoc_mc_ec, ppuLoc_ec_lds;
+	static GLint ppuLoc_color;
 
 	void defineModel(double dx, double fx, double dy, double fy, double dz, double fz);
 	static void fetchGLSLVariableLocations();
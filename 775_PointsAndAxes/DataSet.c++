@@ -0,0 +1,627 @@
+// DataSet.c++ -- The variables read from an OKC file and derived data
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#include "DataSet.h"
+#include "LandmarkMDS.h"
+#include "RandomProjection.h"
+#include "TSNE.h"
+
+DataSet::DataSet() : nVariables(0), nRows(0), variables(NULL),
+	haveCovariance(false), robustCovariance(false),
+	haveSentinel(false), sentinel(0.0),
+	maxCategories(DEFAULT_MAX_CATEGORIES), targetVariable(-1), nCategorical(0)
+{
+}
+
+DataSet::~DataSet()
+{
+	for (int i=0 ; i<nVariables ; i++)
+	{
+		delete [] variables[i].value;
+		delete [] variables[i].code8;
+		delete [] variables[i].code16;
+	}
+	delete [] variables;
+}
+
+PCA* DataSet::createPCA(const std::vector<int>& subset)
+{
+	return new PCA(getCovariance(), subset, nRows);
+}
+
+const Eigen::MatrixXd& DataSet::getCovariance()
+{
+	if (!haveCovariance)
+	{
+		const unsigned char* mask = getMissingMask();
+		if (!robustCovariance && (mask == NULL) && (nCategorical > 0) &&
+			!PCA::getMixedPrecision())
+			computeCategoricalCovariance();
+		else
+		{
+			std::vector<int> all(nVariables);
+			for (int i=0 ; i<nVariables ; i++)
+				all[i] = i;
+			std::vector<float> values;
+			std::vector<float*> rows;
+			getSubsetValues(all, values, rows);
+			if (robustCovariance)
+				PCA::computeMCDCovariance(rows.data(), mask, nVariables, nRows,
+					MCD_SUBSAMPLE_SIZE, covariance);
+			else
+				PCA::computePairwiseCovariance(rows.data(), mask, nVariables, nRows,
+					covariance);
+		}
+		haveCovariance = true;
+	}
+	return covariance;
+}
+
+void DataSet::getNormalizedValues(int variable, float* out, int stride) const
+{
+	// missing values are replaced by the variable's mean once normalized
+	const Variable& v = variables[variable];
+	if (v.isCategorical())
+	{
+		std::vector<float> table;
+		getCategoryValues(v, table);
+		float missingValue = table.back();
+		for (int j=0 ; j<nRows ; j++)
+		{
+			int code = v.getCode(j);
+			out[j*stride] = (code < 0) ? missingValue : table[code];
+		}
+	}
+	else
+	{
+		float missingValue = v.alpha * v.mean + v.beta;
+		for (int j=0 ; j<nRows ; j++)
+			out[j*stride] = std::isnan(v.value[j]) ? missingValue :
+				v.alpha * v.value[j] + v.beta;
+	}
+}
+
+int DataSet::getVariableIndex(const std::string& name) const
+{
+	for (int i=0 ; i<nVariables ; i++)
+		if (variables[i].name == name)
+			return i;
+	return -1;
+}
+
+Reducer* DataSet::createReducer(ReducerType type, const std::vector<int>& subset)
+{
+	if (type == RANDOM_PROJECTION_REDUCER)
+		return new RandomProjection(subset.size(), 6);
+	if ((type == LANDMARK_MDS_REDUCER) || (type == TSNE_REDUCER))
+	{
+		std::vector<float> values;
+		std::vector<float*> rows;
+		getSubsetValues(subset, values, rows);
+		if (type == TSNE_REDUCER)
+			return new TSNE(rows.data(), subset.size(), nRows);
+		return new LandmarkMDS(rows.data(), subset.size(), nRows, 6);
+	}
+	return createPCA(subset);
+}
+
+int DataSet::getAttributeValues(const std::vector<int>& subset, int maxVariables,
+	std::vector<float>& values) const
+{
+	std::vector<int> first(subset.begin(),
+		subset.begin() + std::min(maxVariables, static_cast<int>(subset.size())));
+	std::vector<float*> rows;
+	getSubsetValues(first, values, rows);
+	return first.size();
+}
+
+void DataSet::getSubsetValues(const std::vector<int>& subset,
+	std::vector<float>& values, std::vector<float*>& rows) const
+{
+	int nVars = subset.size();
+	values.resize(nRows * nVars);
+	rows.resize(nRows);
+	for (int i=0 ; i<nRows ; i++)
+		rows[i] = &values[i*nVars];
+	for (int j=0 ; j<nVars ; j++)
+		getNormalizedValues(subset[j], &values[j], nVars);
+}
+
+void DataSet::project(const Reducer& reducer, const std::vector<int>& subset,
+	cryph::Point3f* pts, float* sps, float* sz, float* crs) const
+{
+	std::vector<float> values;
+	std::vector<float*> rows;
+	getSubsetValues(subset, values, rows);
+
+	std::vector<float> components(nRows * 6);
+	std::vector<float*> result(nRows);
+	for (int i=0 ; i<nRows ; i++)
+		result[i] = &components[i*6];
+	reducer.reduce(rows.data(), subset.size(), nRows, 6, result.data());
+
+	for (int i=0 ; i<nRows ; i++)
+	{
+		const float* c = result[i];
+		pts[i] = cryph::Point3f(c[0], c[1], c[2]);
+		sps[i] = c[3];
+		sz[i] = c[4];
+		crs[i] = c[5];
+	}
+}
+
+bool DataSet::readOKC(const std::string& fileName)
+{
+	std::ifstream infile(fileName.c_str());
+	if (!infile.good())
+	{
+		std::cerr << "Could not open" << fileName << "for reading." << std::endl;
+		return false;
+	}
+
+	int N = 0; //the number of variables
+	int R = 0; // the number of data points
+	int nLine(0); // the number of lines already read from the file
+	std::string line; //line string read from the file
+	int i(0),j(0);
+
+	// Gathered while parsing the data lines so that neither missing values
+	// nor degenerate columns need another pass over the file
+	std::vector<double> sum;
+	std::vector<float> observedMin, observedMax;
+	int nMissingTotal = 0;
+	// Variables that may still be categorical are coded as they are read:
+	// each distinct value gets the next code. The first value that is not
+	// an integer, or one too many distinct values, decodes the column.
+	std::vector<std::map<float,int> > distinct;
+	std::vector<bool> maybeCategorical;
+
+	while (std::getline(infile, line))
+	{
+		nLine++;
+		if (nLine == 1)
+		{
+			std::stringstream iss(line);
+			if (iss >> N >> R)//process initialization
+			{
+				variables = new Variable[N];
+				for(i=0; i < N; i++)
+				{
+					variables[i].value = NULL;
+					variables[i].nMissing = 0;
+					variables[i].code8 = new unsigned char[R];
+					variables[i].code16 = NULL;
+				}
+				nVariables = N;
+				distinct.resize(N);
+				maybeCategorical.assign(N, true);
+				sum.assign(N, 0.0);
+				observedMin.assign(N, std::numeric_limits<float>::max());
+				observedMax.assign(N, -std::numeric_limits<float>::max());
+				missing.assign(static_cast<size_t>(N) * R, 0);
+				continue;
+			}
+			else
+			{
+				std::cout << "Format Error!" << std::endl;
+				return false;
+			}
+		}
+		else if (nLine <= N+1) //read from line 2 to line N+1
+		{
+			variables[nLine-2].count = nLine - 1;
+			variables[nLine-2].name = line;
+		}
+		else if (nLine <= 2*N + 1) //read from line N+2 to line 2N+1
+		{
+			Variable& v = variables[nLine-N-2];
+			std::stringstream iss(line);
+			iss >> v.minValue >> v.maxValue >> v.cardinality;
+		}
+		else if (j < R) //read from line 2N+2 to line 2N+R+1
+		{
+			std::stringstream iss(line);
+			std::string token;
+			for(i=0;i < N;i++)
+			{
+				// Anything that is not a number ("?", "NA", "nan", a short
+				// line, ...) or equals the sentinel is missing.
+				float v = std::numeric_limits<float>::quiet_NaN();
+				if (iss >> token)
+				{
+					char* end;
+					v = strtof(token.c_str(), &end);
+					if ((end == token.c_str()) || (*end != '\0') || !std::isfinite(v) ||
+						(haveSentinel && (v == sentinel)))
+						v = std::numeric_limits<float>::quiet_NaN();
+				}
+				Variable& var = variables[i];
+				if (std::isnan(v))
+				{
+					missing[static_cast<size_t>(j)*N + i] = 1;
+					var.nMissing++;
+					nMissingTotal++;
+				}
+				else
+				{
+					sum[i] += v;
+					observedMin[i] = std::min(observedMin[i], v);
+					observedMax[i] = std::max(observedMax[i], v);
+				}
+				if (maybeCategorical[i])
+				{
+					int code = -1; // missing
+					if (!std::isnan(v))
+					{
+						std::map<float,int>::iterator it = distinct[i].find(v);
+						if (it != distinct[i].end())
+							code = it->second;
+						else if ((v == std::floor(v)) &&
+								(distinct[i].size() < getCategoryLimit(var)))
+						{
+							code = distinct[i].size();
+							distinct[i][v] = code;
+						}
+						else
+						{
+							decodeCategorical(var, distinct[i], j, R);
+							maybeCategorical[i] = false;
+							distinct[i].clear();
+						}
+					}
+					if (maybeCategorical[i])
+						setCode(var, j, code, R);
+				}
+				if (!maybeCategorical[i])
+					var.value[j] = v;
+			}
+			j++;
+		}
+	}
+	nRows = j;
+	if (nRows == 0)
+	{
+		std::cerr << fileName << " has no data rows." << std::endl;
+		return false;
+	}
+	missing.resize(static_cast<size_t>(nRows) * N);
+	if (nMissingTotal == 0)
+		missing.clear();
+	else
+		std::cerr << fileName << ": " << nMissingTotal << " missing values.\n";
+
+	for (i = 0; i < N; i++)
+	{
+		Variable& v = variables[i];
+		int nPresent = nRows - v.nMissing;
+		v.mean = (nPresent > 0) ? sum[i] / nPresent : 0.0;
+		// A header range that is empty (or inverted) is replaced by the
+		// observed range; a valid one that the data falls outside of is
+		// widened to include it. If the observed range is empty too, the
+		// column is constant and normalizes to 0.5 everywhere.
+		if (nPresent > 0)
+		{
+			if (!(v.maxValue > v.minValue))
+			{
+				v.minValue = observedMin[i];
+				v.maxValue = observedMax[i];
+			}
+			else
+			{
+				v.minValue = std::min(v.minValue, observedMin[i]);
+				v.maxValue = std::max(v.maxValue, observedMax[i]);
+			}
+		}
+		if (v.maxValue > v.minValue)
+		{
+			v.alpha = 1/(v.maxValue - v.minValue);
+			v.beta = - v.minValue/(v.maxValue - v.minValue);
+		}
+		else
+		{
+			std::cerr << "Variable '" << v.name << "' is constant.\n";
+			v.alpha = 0.0;
+			v.beta = 0.5;
+		}
+	}
+
+	nCategorical = 0;
+	for (i = 0; i < N; i++)
+	{
+		if (!maybeCategorical[i])
+			continue;
+		if (distinct[i].empty()) // nothing but missing values
+			decodeCategorical(variables[i], distinct[i], nRows, R);
+		else
+		{
+			encodeCategorical(variables[i], distinct[i]);
+			nCategorical++;
+		}
+	}
+	if ((targetVariable >= 0) && (targetVariable < N))
+		encodeTargetMeans();
+	return true;
+}
+
+void DataSet::computeCategoricalCovariance()
+{
+	// Categorical variables contribute through counts: for each category,
+	// the number of rows and the sums of the continuous variables over
+	// them, and for each pair of categorical variables the co-occurrence
+	// counts. Only continuous pairs need per-row products.
+	int N = nVariables;
+	std::vector<int> continuous, categorical;
+	std::vector<std::vector<float> > f(N); // normalized value per category
+	for (int i=0 ; i<N ; i++)
+		if (variables[i].isCategorical())
+		{
+			categorical.push_back(i);
+			getCategoryValues(variables[i], f[i]);
+		}
+		else
+			continuous.push_back(i);
+	int nCont = continuous.size(), nCat = categorical.size();
+
+	std::vector<double> contSums(nCont, 0.0), contProducts(nCont*nCont, 0.0);
+	// per categorical variable: [category][continuous variable] sums, and counts
+	std::vector<std::vector<double> > categorySums(nCat);
+	std::vector<std::vector<int> > categoryCounts(nCat);
+	for (int a=0 ; a<nCat ; a++)
+	{
+		int nc = variables[categorical[a]].categories.size();
+		categorySums[a].assign(nc*nCont, 0.0);
+		categoryCounts[a].assign(nc, 0);
+	}
+	// per pair of categorical variables (a < b): counts[ca*ncb + cb], unless
+	// that table would be too large, in which case products are summed
+	std::vector<std::vector<int> > coCounts(nCat*nCat);
+	std::vector<double> catProducts(nCat*nCat, 0.0);
+	for (int a=0 ; a<nCat ; a++)
+		for (int b=a+1 ; b<nCat ; b++)
+		{
+			long size = (long)variables[categorical[a]].categories.size() *
+				variables[categorical[b]].categories.size();
+			if (size <= MAX_CO_COUNTS)
+				coCounts[a*nCat+b].assign(size, 0);
+		}
+
+	// there are no missing values here, so every code is valid
+	std::vector<int> code(nCat);
+	std::vector<float> x(nCont); // normalized continuous values of a row
+	for (int r=0 ; r<nRows ; r++)
+	{
+		for (int a=0 ; a<nCat ; a++)
+			code[a] = variables[categorical[a]].getCode(r);
+		for (int p=0 ; p<nCont ; p++)
+		{
+			const Variable& v = variables[continuous[p]];
+			x[p] = v.alpha * v.value[r] + v.beta;
+		}
+		for (int p=0 ; p<nCont ; p++)
+		{
+			double xp = x[p];
+			contSums[p] += xp;
+			for (int q=p ; q<nCont ; q++)
+				contProducts[p*nCont+q] += xp * x[q];
+		}
+		for (int a=0 ; a<nCat ; a++)
+		{
+			categoryCounts[a][code[a]]++;
+			double* sums = &categorySums[a][code[a]*nCont];
+			for (int p=0 ; p<nCont ; p++)
+				sums[p] += x[p];
+			for (int b=a+1 ; b<nCat ; b++)
+			{
+				std::vector<int>& counts = coCounts[a*nCat+b];
+				if (counts.empty())
+					catProducts[a*nCat+b] += (double)f[categorical[a]][code[a]] *
+						f[categorical[b]][code[b]];
+				else
+					counts[code[a]*variables[categorical[b]].categories.size() + code[b]]++;
+			}
+		}
+	}
+
+	// E[xy] for every pair, then subtract the product of the means
+	std::vector<double> mean(N, 0.0);
+	Eigen::MatrixXd E(N, N);
+	for (int p=0 ; p<nCont ; p++)
+	{
+		mean[continuous[p]] = contSums[p] / nRows;
+		for (int q=p ; q<nCont ; q++)
+			E(continuous[p], continuous[q]) = E(continuous[q], continuous[p]) =
+				contProducts[p*nCont+q] / nRows;
+	}
+	for (int a=0 ; a<nCat ; a++)
+	{
+		int i = categorical[a];
+		const std::vector<int>& counts = categoryCounts[a];
+		double m = 0.0, m2 = 0.0;
+		for (int c=0 ; c<counts.size() ; c++)
+		{
+			m += counts[c] * f[i][c];
+			m2 += counts[c] * f[i][c] * f[i][c];
+		}
+		mean[i] = m / nRows;
+		E(i,i) = m2 / nRows;
+		for (int p=0 ; p<nCont ; p++)
+		{
+			double e = 0.0;
+			for (int c=0 ; c<counts.size() ; c++)
+				e += f[i][c] * categorySums[a][c*nCont + p];
+			E(i, continuous[p]) = E(continuous[p], i) = e / nRows;
+		}
+		for (int b=a+1 ; b<nCat ; b++)
+		{
+			int k = categorical[b];
+			const std::vector<int>& co = coCounts[a*nCat+b];
+			double e = catProducts[a*nCat+b];
+			int nck = variables[k].categories.size();
+			for (int c=0 ; c<co.size() ; c++)
+				if (co[c] != 0)
+					e += co[c] * (double)f[i][c/nck] * f[k][c%nck];
+			E(i,k) = E(k,i) = e / nRows;
+		}
+	}
+	covariance.resize(N, N);
+	for (int i=0 ; i<N ; i++)
+		for (int j=0 ; j<N ; j++)
+			covariance(i,j) = E(i,j) - mean[i]*mean[j];
+}
+
+void DataSet::decodeCategorical(Variable& v, const std::map<float,int>& codes,
+	int nRead, int nAllocated) // CLASS METHOD
+{
+	// the values of the first nRead rows, which until now were coded
+	std::vector<float> table(codes.size());
+	for (std::map<float,int>::const_iterator it=codes.begin() ; it!=codes.end() ; it++)
+		table[it->second] = it->first;
+	v.value = new float[nAllocated];
+	for (int j=0 ; j<nRead ; j++)
+	{
+		int code = v.getCode(j);
+		v.value[j] = (code < 0) ? std::numeric_limits<float>::quiet_NaN() : table[code];
+	}
+	delete [] v.code8;
+	delete [] v.code16;
+	v.code8 = NULL;
+	v.code16 = NULL;
+}
+
+void DataSet::encodeCategorical(Variable& v, const std::map<float,int>& codes)
+{
+	// Codes were assigned in the order values were first read; renumber
+	// them so that they index the sorted categories.
+	std::vector<int> sorted(codes.size());
+	for (std::map<float,int>::const_iterator it=codes.begin() ; it!=codes.end() ; it++)
+	{
+		sorted[it->second] = v.categories.size();
+		v.categories.push_back(it->first);
+	}
+	for (int j=0 ; j<nRows ; j++)
+	{
+		int code = v.getCode(j);
+		if (code < 0)
+			continue;
+		if (v.code8 != NULL)
+			v.code8[j] = sorted[code];
+		else
+			v.code16[j] = sorted[code];
+	}
+}
+
+void DataSet::encodeTargetMeans()
+{
+	// normalized (mean-imputed) value of the target in each row
+	const Variable& t = variables[targetVariable];
+	std::vector<double> target(nRows);
+	double targetMean = 0.0;
+	for (int j=0 ; j<nRows ; j++)
+	{
+		float raw = t.getValue(j);
+		target[j] = t.alpha * (std::isnan(raw) ? t.mean : raw) + t.beta;
+		targetMean += target[j];
+	}
+	targetMean /= nRows;
+
+	for (int i=0 ; i<nVariables ; i++)
+	{
+		Variable& v = variables[i];
+		if ((i == targetVariable) || !v.isCategorical())
+			continue;
+		int nc = v.categories.size();
+		std::vector<double> sums(nc, 0.0);
+		std::vector<int> counts(nc, 0);
+		for (int j=0 ; j<nRows ; j++)
+		{
+			int code = v.getCode(j);
+			if (code >= 0)
+			{
+				sums[code] += target[j];
+				counts[code]++;
+			}
+		}
+		// shrink rare categories toward the overall mean
+		v.encoded.resize(nc);
+		for (int c=0 ; c<nc ; c++)
+			v.encoded[c] = (sums[c] + TARGET_SMOOTHING*targetMean) /
+				(counts[c] + TARGET_SMOOTHING);
+	}
+}
+
+void DataSet::getCategoryValues(const Variable& v, std::vector<float>& table)
+	// CLASS METHOD
+{
+	// one normalized value per category, then the one used where missing
+	table.clear();
+	if (v.encoded.empty())
+	{
+		for (int c=0 ; c<v.categories.size() ; c++)
+			table.push_back(v.alpha * v.categories[c] + v.beta);
+		table.push_back(v.alpha * v.mean + v.beta);
+	}
+	else
+	{
+		double sum = 0.0;
+		for (int c=0 ; c<v.encoded.size() ; c++)
+		{
+			table.push_back(v.encoded[c]);
+			sum += v.encoded[c];
+		}
+		table.push_back(sum / v.encoded.size());
+	}
+}
+
+int DataSet::getCategoryLimit(const Variable& v) const
+{
+	int limit = std::max(maxCategories, (int)v.cardinality);
+	return std::min(limit, 0xFFFE);
+}
+
+void DataSet::setCode(Variable& v, int row, int code, int nAllocated)
+	// CLASS METHOD
+{
+	if ((v.code8 != NULL) && (code >= 0xFF))
+	{
+		// too many categories for 8 bits
+		v.code16 = new unsigned short[nAllocated];
+		for (int j=0 ; j<row ; j++)
+			v.code16[j] = (v.code8[j] == 0xFF) ? 0xFFFF : v.code8[j];
+		delete [] v.code8;
+		v.code8 = NULL;
+	}
+	if (v.code8 != NULL)
+		v.code8[row] = (code < 0) ? 0xFF : code;
+	else
+		v.code16[row] = (code < 0) ? 0xFFFF : code;
+}
+
+void DataSet::setMissingValueSentinel(float sentinelIn)
+{
+	haveSentinel = true;
+	sentinel = sentinelIn;
+}
+
+void DataSet::setRobustCovariance(bool b)
+{
+	if (b != robustCovariance)
+		haveCovariance = false;
+	robustCovariance = b;
+}
+
+bool DataSet::validSubset(const std::vector<int>& subset) const
+{
+	if (subset.empty())
+		return false;
+	for (std::vector<int>::const_iterator it=subset.begin() ; it<subset.end() ; it++)
+		if ((*it < 0) || (*it >= nVariables))
+			return false;
+	return true;
+}
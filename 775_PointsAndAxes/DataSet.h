@@ -0,0 +1,113 @@
+// DataSet.h -- The variables read from an OKC file, their normalized values
+//              (computed on demand), and the covariance of all of them. The covariance is computed
+//              once (when first needed) so that PCA of any subset of the
+//              variables only requires an eigen-solve of the corresponding
+//              submatrix.
+
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Point3.h"
+#include "PCA.h"
+#include "Reducer.h"
+#include "Variable.h"
+
+class DataSet
+{
+public:
+	DataSet();
+	virtual ~DataSet();
+
+	// Values that are not numbers (or equal the sentinel, if one has been
+	// set before reading) are treated as missing. They are NaN in the
+	// Variable values, replaced by the mean in the normalized values, and
+	// left out of the covariance. A column with no range normalizes to 0.5.
+	// Returns false (after reporting why) if the file cannot be read.
+	bool readOKC(const std::string& fileName);
+	void setMissingValueSentinel(float sentinelIn);
+	// Use the (outlier-resistant) MCD estimate of the covariance
+	void setRobustCovariance(bool b);
+	// Variables whose values are all integers, with at most the larger of
+	// this and their OKC cardinality distinct values, are categorical: they
+	// are stored as 8 or 16 bit codes into a table of their values, both
+	// while reading and after.
+	void setMaxCategories(int m) { maxCategories = m; }
+	// Normalize categorical variables read from now on by the (smoothed)
+	// mean of the given variable over each of their categories rather than
+	// by their values; -1 turns this off.
+	void setTargetEncoding(int targetVariableIn) { targetVariable = targetVariableIn; }
+	int getNumCategorical() const { return nCategorical; }
+
+	int getNumVariables() const { return nVariables; }
+	int getNumRows() const { return nRows; }
+	const Variable* getVariables() const { return variables; }
+	// (alpha*value + beta) of "variable" in each row, or its category's
+	// value from the table, stored at out[0], out[stride], ...
+	void getNormalizedValues(int variable, float* out, int stride=1) const;
+	// nonzero at [row*getNumVariables() + variable] for missing values;
+	// NULL if there are none
+	const unsigned char* getMissingMask() const
+		{ return missing.empty() ? NULL : &missing[0]; }
+	// covariance of the normalized values of all variables. Without missing
+	// values, and unless the robust or mixed precision covariance is used,
+	// categorical variables enter through per-category counts and no
+	// per-row values are copied; otherwise it is computed from a temporary
+	// copy of all normalized values.
+	const Eigen::MatrixXd& getCovariance();
+	// index of the variable with the given name; -1 if there is none
+	int getVariableIndex(const std::string& name) const;
+
+	// "subset" holds 0-based variable indices
+	PCA* createPCA(const std::vector<int>& subset);
+	// A TSNE is returned before it has been optimized; see TSNE.h
+	Reducer* createReducer(ReducerType type, const std::vector<int>& subset);
+	// Reduce each row to six components with "reducer", which must have
+	// been created from the same subset. The first three give the point;
+	// the remaining three its shape, size and color attributes.
+	void project(const Reducer& reducer, const std::vector<int>& subset,
+		cryph::Point3f* pts, float* sps, float* sz, float* crs) const;
+	bool validSubset(const std::vector<int>& subset) const;
+	// The normalized values of the first (at most) maxVariables variables
+	// of "subset", nRows x (the number returned), row-major
+	int getAttributeValues(const std::vector<int>& subset, int maxVariables,
+		std::vector<float>& values) const;
+
+private:
+	DataSet(const DataSet& d) {} // do not allow copies
+
+	// fills "rows" with one pointer per row into "values", which holds
+	// the normalized values of just the variables in "subset"
+	void getSubsetValues(const std::vector<int>& subset,
+		std::vector<float>& values, std::vector<float*>& rows) const;
+
+	void computeCategoricalCovariance();
+	void encodeCategorical(Variable& v, const std::map<float,int>& codes);
+	void encodeTargetMeans();
+	int getCategoryLimit(const Variable& v) const;
+	static void getCategoryValues(const Variable& v, std::vector<float>& table);
+	// while reading: code -1 marks a missing value
+	static void setCode(Variable& v, int row, int code, int nAllocated);
+	static void decodeCategorical(Variable& v, const std::map<float,int>& codes,
+		int nRead, int nAllocated);
+
+	int nVariables, nRows;
+	Variable* variables;
+	Eigen::MatrixXd covariance;
+	bool haveCovariance, robustCovariance;
+	std::vector<unsigned char> missing;
+	bool haveSentinel;
+	float sentinel;
+
+	int maxCategories, targetVariable, nCategorical;
+
+	static const int MCD_SUBSAMPLE_SIZE = 2000;
+	static const int DEFAULT_MAX_CATEGORIES = 64;
+	static const int MAX_CO_COUNTS = 65536; // per pair of categorical variables
+	static const int TARGET_SMOOTHING = 10; // rows' worth of the overall mean
+};
+
+#endif
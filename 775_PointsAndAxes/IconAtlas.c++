@@ -0,0 +1,117 @@
+// IconAtlas.c++
+
+#include <cmath>
+#include <iostream>
+
+#include "IconAtlas.h"
+#include "ImageLoader.h"
+
+// transparent texels left around each icon in its cell so that linear
+// filtering never reaches into a neighboring cell
+static const int ICON_MARGIN = 2;
+
+// Scales "image" to fit a (size x size) box, keeping its aspect ratio,
+// and writes it as RGBA centered in the box at (x0, y0) of "atlas".
+static void packIcon(const cryph::Packed3DArray<GLubyte>* image, int size,
+	GLubyte* atlas, int atlasWidth, int x0, int y0)
+{
+	int h = image->getDim1(), w = image->getDim2(), nChannels = image->getDim3();
+	double scale = static_cast<double>(size) / ((w > h) ? w : h);
+	int fitW = static_cast<int>(w*scale + 0.5), fitH = static_cast<int>(h*scale + 0.5);
+	x0 += (size - fitW) / 2;
+	y0 += (size - fitH) / 2;
+	for (int y=0 ; y<fitH ; y++)
+	{
+		// average the source texels the destination texel covers
+		int r0 = static_cast<int>(y / scale), r1 = static_cast<int>((y+1) / scale);
+		if (r1 <= r0) r1 = r0 + 1;
+		if (r1 > h) r1 = h;
+		for (int x=0 ; x<fitW ; x++)
+		{
+			int c0 = static_cast<int>(x / scale), c1 = static_cast<int>((x+1) / scale);
+			if (c1 <= c0) c1 = c0 + 1;
+			if (c1 > w) c1 = w;
+			double sum[4] = { 0.0, 0.0, 0.0, 0.0 };
+			for (int r=r0 ; r<r1 ; r++)
+				for (int c=c0 ; c<c1 ; c++)
+				{
+					GLubyte v[4];
+					const GLubyte* src = image->getRow(r, c).data;
+					for (int k=0 ; k<nChannels ; k++)
+						v[k] = src[k];
+					if (nChannels < 3) // gray (+ alpha)
+					{
+						v[3] = (nChannels == 2) ? v[1] : 255;
+						v[1] = v[2] = v[0];
+					}
+					else if (nChannels == 3)
+						v[3] = 255;
+					for (int k=0 ; k<4 ; k++)
+						sum[k] += v[k];
+				}
+			int n = (r1 - r0) * (c1 - c0);
+			GLubyte* texel = &atlas[4*((y0 + y)*atlasWidth + x0 + x)];
+			for (int k=0 ; k<4 ; k++)
+				texel[k] = static_cast<GLubyte>(sum[k] / n + 0.5);
+		}
+	}
+}
+
+IconAtlas::IconAtlas() : texture(0), gridSide(0), nIcons(0)
+{
+}
+
+IconAtlas::~IconAtlas()
+{
+	if (texture > 0)
+		glDeleteTextures(1, &texture);
+}
+
+bool IconAtlas::load(const std::vector<std::string>& fileNames)
+{
+	int n = fileNames.size();
+	if ((n == 0) || (n > MAX_ICONS))
+	{
+		std::cerr << "IconAtlas: between 1 and " << MAX_ICONS << " icons are needed\n";
+		return false;
+	}
+	int side = static_cast<int>(ceil(sqrt(static_cast<double>(n))));
+	int width = side * CELL_SIZE;
+	std::vector<GLubyte> atlas(4*width*width, 0);
+	// decode them all in parallel (or find them already decoded)
+	std::vector<std::shared_future<ImageLoader::Image>> images;
+	for (int k=0 ; k<n ; k++)
+		images.push_back(ImageLoader::loadAsync(fileNames[k]));
+	for (int k=0 ; k<n ; k++)
+	{
+		ImageLoader::Image image = images[k].get();
+		if (image == NULL)
+		{
+			std::cerr << "IconAtlas: could not read " << fileNames[k] << '\n';
+			return false;
+		}
+		packIcon(image->getInternalPacked3DArrayImage(), CELL_SIZE - 2*ICON_MARGIN,
+			&atlas[0], width, (k % side)*CELL_SIZE + ICON_MARGIN,
+			(k / side)*CELL_SIZE + ICON_MARGIN);
+	}
+
+	if (texture > 0)
+		glDeleteTextures(1, &texture);
+	int levels = 1;
+	for (int s=CELL_SIZE ; s>1 ; s/=2)
+		levels++;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexStorage2D(GL_TEXTURE_2D, levels, GL_RGBA8, width, width);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, width, GL_RGBA, GL_UNSIGNED_BYTE, &atlas[0]);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	gridSide = side;
+	nIcons = n;
+	return true;
+}
@@ -0,0 +1,40 @@
+// IconAtlas.h -- A set of icon images (anything ImageReader can read) packed
+//                once into a single mipmapped RGBA texture. Icon k occupies
+//                cell (k % gridSide, k / gridSide) of a gridSide x gridSide
+//                grid of CELL_SIZE x CELL_SIZE cells; each icon is scaled to
+//                fit its cell (keeping its aspect ratio) and centered on a
+//                transparent background.
+
+#ifndef ICONATLAS_H
+#define ICONATLAS_H
+
+#include <string>
+#include <vector>
+#include <GL/gl.h>
+
+class IconAtlas
+{
+public:
+	IconAtlas();
+	virtual ~IconAtlas();
+
+	// Returns false (leaving the atlas as it was) if any file cannot be
+	// read or there are more than MAX_ICONS of them.
+	bool load(const std::vector<std::string>& fileNames);
+
+	GLuint getTexture() const { return texture; }
+	int getGridSide() const { return gridSide; }
+	int getNumIcons() const { return nIcons; }
+
+	// A power of two, so no mipmap level mixes texels of adjacent cells
+	static const int CELL_SIZE = 64;
+	static const int MAX_ICONS = 64;
+
+private:
+	IconAtlas(const IconAtlas& a) {} // do not allow copies
+
+	GLuint texture;
+	int gridSide, nIcons;
+};
+
+#endif
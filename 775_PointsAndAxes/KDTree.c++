@@ -0,0 +1,323 @@
+// KDTree.c++ -- A k-d tree over points of any (small) dimension
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+#include "KDTree.h"
+
+// Maximum number of points in a leaf
+static const int LEAF_SIZE = 16;
+
+int KDTree::numBuildThreads = 0;
+
+// Orders point indices by one of their coordinates (for std::nth_element)
+struct CoordLess
+{
+	const float* coords;
+	int dim, axis;
+
+	CoordLess(const float* c, int d, int a) : coords(c), dim(d), axis(a) {}
+	bool operator()(int i, int j) const
+		{ return coords[i*dim + axis] < coords[j*dim + axis]; }
+};
+
+KDTree::KDTree(int dimIn) : dim(dimIn), nPoints(0), nInTree(0), maxDepth(0)
+{
+	if (dim < 1)
+		dim = 1;
+}
+
+KDTree::~KDTree()
+{
+}
+
+void KDTree::append(const float* newCoords, int nNew)
+{
+	if (nNew <= 0)
+		return;
+	coords.insert(coords.end(), newCoords, newCoords + nNew*dim);
+	nPoints += nNew;
+	int nPending = nPoints - nInTree;
+	if ((nPending > LEAF_SIZE) && (nPending > nInTree / 8))
+		rebuild();
+}
+
+float KDTree::boxDistanceSquared(int node, const float* q) const
+{
+	const float* lo = &bounds[2*dim*node];
+	const float* hi = lo + dim;
+	float d2 = 0.0;
+	for (int d=0 ; d<dim ; d++)
+	{
+		float delta = 0.0;
+		if (q[d] < lo[d])
+			delta = lo[d] - q[d];
+		else if (q[d] > hi[d])
+			delta = q[d] - hi[d];
+		d2 += delta * delta;
+	}
+	return d2;
+}
+
+void KDTree::build(const float* coordsIn, int nPointsIn)
+{
+	if (nPointsIn < 0)
+		nPointsIn = 0;
+	coords.assign(coordsIn, coordsIn + nPointsIn*dim);
+	nPoints = nPointsIn;
+	rebuild();
+}
+
+void KDTree::buildNode(int node, int begin, int end, int depth, int threadDepth)
+{
+	Node& n = nodes[node];
+	n.begin = begin;
+	n.end = end;
+	n.axis = -1;
+
+	float* lo = &bounds[2*dim*node];
+	float* hi = lo + dim;
+	for (int d=0 ; d<dim ; d++)
+	{
+		lo[d] = std::numeric_limits<float>::max();
+		hi[d] = -std::numeric_limits<float>::max();
+	}
+	for (int i=begin ; i<end ; i++)
+	{
+		const float* p = &coords[perm[i]*dim];
+		for (int d=0 ; d<dim ; d++)
+		{
+			if (p[d] < lo[d])
+				lo[d] = p[d];
+			if (p[d] > hi[d])
+				hi[d] = p[d];
+		}
+	}
+	if (((end - begin) <= LEAF_SIZE) || (depth == maxDepth))
+		return;
+
+	// split at the median of the widest dimension
+	int axis = 0;
+	for (int d=1 ; d<dim ; d++)
+		if ((hi[d] - lo[d]) > (hi[axis] - lo[axis]))
+			axis = d;
+	if (hi[axis] <= lo[axis]) // all points coincide
+		return;
+	int mid = (begin + end) / 2;
+	std::nth_element(perm.begin()+begin, perm.begin()+mid, perm.begin()+end,
+		CoordLess(&coords[0], dim, axis));
+	n.axis = axis;
+	n.split = coords[perm[mid]*dim + axis];
+
+	if (depth < threadDepth)
+	{
+		std::thread left(&KDTree::buildNode, this, 2*node+1, begin, mid, depth+1, threadDepth);
+		buildNode(2*node+2, mid, end, depth+1, threadDepth);
+		left.join();
+	}
+	else
+	{
+		buildNode(2*node+1, begin, mid, depth+1, threadDepth);
+		buildNode(2*node+2, mid, end, depth+1, threadDepth);
+	}
+}
+
+float KDTree::distanceSquared(int i, const float* q) const
+{
+	const float* p = &coords[i*dim];
+	float d2 = 0.0;
+	for (int d=0 ; d<dim ; d++)
+		d2 += (p[d] - q[d]) * (p[d] - q[d]);
+	return d2;
+}
+
+void KDTree::inPolygon(const float* xy, int nVertices, std::vector<int>& result) const
+{
+	if ((nVertices < 3) || (dim < 2))
+		return;
+
+	// candidates: points inside the bounding rectangle of the polygon
+	std::vector<float> lo(dim, -std::numeric_limits<float>::max());
+	std::vector<float> hi(dim, std::numeric_limits<float>::max());
+	lo[0] = hi[0] = xy[0];
+	lo[1] = hi[1] = xy[1];
+	for (int v=1 ; v<nVertices ; v++)
+	{
+		lo[0] = std::min(lo[0], xy[2*v]); hi[0] = std::max(hi[0], xy[2*v]);
+		lo[1] = std::min(lo[1], xy[2*v+1]); hi[1] = std::max(hi[1], xy[2*v+1]);
+	}
+	std::vector<int> candidates;
+	inRectangle(&lo[0], &hi[0], candidates);
+
+	// even-odd rule crossing test on each candidate
+	for (std::vector<int>::iterator it=candidates.begin() ; it<candidates.end() ; it++)
+	{
+		float x = coords[*it*dim], y = coords[*it*dim + 1];
+		bool inside = false;
+		for (int v=0, u=nVertices-1 ; v<nVertices ; u=v++)
+		{
+			float xv = xy[2*v], yv = xy[2*v+1];
+			float xu = xy[2*u], yu = xy[2*u+1];
+			if (((yv > y) != (yu > y)) &&
+			    (x < (xu - xv) * (y - yv) / (yu - yv) + xv))
+				inside = !inside;
+		}
+		if (inside)
+			result.push_back(*it);
+	}
+}
+
+void KDTree::inRectangle(const float* lo, const float* hi, std::vector<int>& result) const
+{
+	if (nInTree > 0)
+		inRectangle(0, lo, hi, result);
+	for (int i=nInTree ; i<nPoints ; i++)
+		if (insideRectangle(i, lo, hi))
+			result.push_back(i);
+}
+
+void KDTree::inRectangle(int node, const float* lo, const float* hi, std::vector<int>& result) const
+{
+	const Node& n = nodes[node];
+	const float* nLo = &bounds[2*dim*node];
+	const float* nHi = nLo + dim;
+	bool contained = true;
+	for (int d=0 ; d<dim ; d++)
+	{
+		if ((nHi[d] < lo[d]) || (nLo[d] > hi[d]))
+			return; // disjoint
+		if ((nLo[d] < lo[d]) || (nHi[d] > hi[d]))
+			contained = false;
+	}
+	if (contained)
+		result.insert(result.end(), perm.begin()+n.begin, perm.begin()+n.end);
+	else if (n.axis < 0)
+	{
+		for (int i=n.begin ; i<n.end ; i++)
+			if (insideRectangle(perm[i], lo, hi))
+				result.push_back(perm[i]);
+	}
+	else
+	{
+		inRectangle(2*node+1, lo, hi, result);
+		inRectangle(2*node+2, lo, hi, result);
+	}
+}
+
+bool KDTree::insideRectangle(int i, const float* lo, const float* hi) const
+{
+	const float* p = &coords[i*dim];
+	for (int d=0 ; d<dim ; d++)
+		if ((p[d] < lo[d]) || (p[d] > hi[d]))
+			return false;
+	return true;
+}
+
+int KDTree::kNearest(const float* q, int k, int* indices, float* dist2) const
+{
+	if (k <= 0)
+		return 0;
+	// max-heap on distance of the best k found so far
+	std::vector<std::pair<float,int> > heap;
+	heap.reserve(k+1);
+	if (nInTree > 0)
+		kNearest(0, q, k, heap);
+	for (int i=nInTree ; i<nPoints ; i++)
+	{
+		float d2 = distanceSquared(i, q);
+		if ((heap.size() < k) || (d2 < heap.front().first))
+		{
+			heap.push_back(std::make_pair(d2, i));
+			std::push_heap(heap.begin(), heap.end());
+			if (heap.size() > k)
+			{
+				std::pop_heap(heap.begin(), heap.end());
+				heap.pop_back();
+			}
+		}
+	}
+	std::sort_heap(heap.begin(), heap.end());
+	for (int i=0 ; i<heap.size() ; i++)
+	{
+		indices[i] = heap[i].second;
+		if (dist2 != NULL)
+			dist2[i] = heap[i].first;
+	}
+	return heap.size();
+}
+
+void KDTree::kNearest(int node, const float* q, int k, std::vector<std::pair<float,int> >& heap) const
+{
+	if ((heap.size() == k) && (boxDistanceSquared(node, q) >= heap.front().first))
+		return;
+	const Node& n = nodes[node];
+	if (n.axis < 0)
+	{
+		for (int i=n.begin ; i<n.end ; i++)
+		{
+			float d2 = distanceSquared(perm[i], q);
+			if ((heap.size() < k) || (d2 < heap.front().first))
+			{
+				heap.push_back(std::make_pair(d2, perm[i]));
+				std::push_heap(heap.begin(), heap.end());
+				if (heap.size() > k)
+				{
+					std::pop_heap(heap.begin(), heap.end());
+					heap.pop_back();
+				}
+			}
+		}
+		return;
+	}
+	// visit the child on the query's side of the split first
+	if (q[n.axis] < n.split)
+	{
+		kNearest(2*node+1, q, k, heap);
+		kNearest(2*node+2, q, k, heap);
+	}
+	else
+	{
+		kNearest(2*node+2, q, k, heap);
+		kNearest(2*node+1, q, k, heap);
+	}
+}
+
+int KDTree::nearest(const float* q, float maxDist) const
+{
+	int which;
+	float d2;
+	if (kNearest(q, 1, &which, &d2) == 0)
+		return -1;
+	if ((maxDist >= 0.0) && (d2 > maxDist*maxDist))
+		return -1;
+	return which;
+}
+
+void KDTree::rebuild()
+{
+	nInTree = nPoints;
+	perm.resize(nPoints);
+	for (int i=0 ; i<nPoints ; i++)
+		perm[i] = i;
+
+	// Median splits halve the range at each level, so the depth at which
+	// every node fits in a leaf bounds the size of the heap-ordered tree.
+	maxDepth = 0;
+	for (int size=nPoints ; size>LEAF_SIZE ; size=(size+1)/2)
+		maxDepth++;
+	int nNodes = (1 << (maxDepth+1)) - 1;
+	Node empty = { 0, 0, -1, 0.0 };
+	nodes.assign(nNodes, empty);
+	bounds.assign(2*dim*nNodes, 0.0);
+	if (nPoints == 0)
+		return;
+
+	int nThreads = numBuildThreads;
+	if (nThreads <= 0)
+		nThreads = std::thread::hardware_concurrency();
+	int threadDepth = 0;
+	while ((2 << threadDepth) <= nThreads)
+		threadDepth++;
+	buildNode(0, 0, nPoints, 0, threadDepth);
+}
@@ -0,0 +1,76 @@
+// KDTree.h -- A k-d tree over points of any (small) dimension, supporting
+//             nearest neighbor, k-nearest neighbor, rectangle and lasso
+//             queries. The tree is built in parallel and can absorb
+//             appended points without an immediate full rebuild.
+
+#ifndef KDTREE_H
+#define KDTREE_H
+
+#include <vector>
+
+class KDTree
+{
+public:
+	KDTree(int dimIn);
+	virtual ~KDTree();
+
+	// Replace the contents of the tree with nPointsIn points whose coordinates
+	// are stored consecutively in "coords" (dim floats per point). Point i
+	// is reported by all queries as index i.
+	void build(const float* coords, int nPointsIn);
+	// Add nNew points, numbered from getNumPoints() on. They are scanned
+	// linearly by queries until there are enough of them to warrant
+	// rebuilding the tree.
+	void append(const float* coords, int nNew);
+
+	int getDimension() const { return dim; }
+	int getNumPoints() const { return nPoints; }
+	const float* getPoint(int i) const { return &coords[i*dim]; }
+
+	// Queries. Distances are Euclidean over all "dim" coordinates.
+	// nearest returns -1 if there are no points within maxDist (maxDist < 0
+	// means no limit).
+	int nearest(const float* q, float maxDist=-1.0) const;
+	// Fills indices (and dist2, if not NULL) with the (up to) k nearest
+	// points, closest first. Returns the number found.
+	int kNearest(const float* q, int k, int* indices, float* dist2=NULL) const;
+	// Points p with lo[d] <= p[d] <= hi[d] for all d
+	void inRectangle(const float* lo, const float* hi, std::vector<int>& result) const;
+	// Points whose first two coordinates lie inside the closed polygon
+	// with the given nVertices (x,y) vertices (even-odd rule).
+	void inPolygon(const float* xy, int nVertices, std::vector<int>& result) const;
+
+	// 0 => use std::thread::hardware_concurrency()
+	static void setNumBuildThreads(int n) { numBuildThreads = n; }
+
+private:
+	KDTree(const KDTree& t) {} // do not allow copies
+
+	struct Node
+	{
+		int begin, end; // range in "perm"
+		int axis;       // -1 ==> leaf
+		float split;
+	};
+
+	int dim;
+	int nPoints;
+	int nInTree;   // points [0, nInTree) are in the tree; the rest are pending
+	int maxDepth;
+	std::vector<float> coords; // dim*nPoints
+	std::vector<int> perm;     // point indices, partitioned by the tree
+	std::vector<Node> nodes;   // heap layout: children of i are 2i+1, 2i+2
+	std::vector<float> bounds; // per node: lo[dim], hi[dim]
+
+	void buildNode(int node, int begin, int end, int depth, int threadDepth);
+	void rebuild();
+	float boxDistanceSquared(int node, const float* q) const;
+	float distanceSquared(int i, const float* q) const;
+	void kNearest(int node, const float* q, int k, std::vector<std::pair<float,int> >& heap) const;
+	void inRectangle(int node, const float* lo, const float* hi, std::vector<int>& result) const;
+	bool insideRectangle(int i, const float* lo, const float* hi) const;
+
+	static int numBuildThreads;
+};
+
+#endif
@@ -0,0 +1,120 @@
+// LandmarkMDS.c++ -- Landmark multidimensional scaling
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+#include "Eigen/Core"
+#include "Eigen/Eigen"
+
+#include "LandmarkMDS.h"
+using namespace Eigen;
+
+LandmarkMDS::LandmarkMDS(float** vbls, int nDimensionsIn, int nSamples,
+		int nComponentsIn, int nLandmarks, unsigned int seed) :
+	nDimensions(nDimensionsIn), nComponents(nComponentsIn)
+{
+	if (nLandmarks > nSamples)
+		nLandmarks = nSamples;
+	if (nLandmarks < 2)
+	{
+		std::cerr << "LandmarkMDS: at least two samples are required.\n";
+		return;
+	}
+
+	// choose the landmarks with a partial Fisher-Yates shuffle
+	std::vector<int> order(nSamples);
+	for (int s=0 ; s<nSamples ; s++)
+		order[s] = s;
+	std::mt19937 generator(seed);
+	for (int l=0 ; l<nLandmarks ; l++)
+	{
+		std::uniform_int_distribution<int> pick(l, nSamples-1);
+		std::swap(order[l], order[pick(generator)]);
+	}
+	landmarks.resize(nLandmarks * nDimensions);
+	for (int l=0 ; l<nLandmarks ; l++)
+		std::copy(vbls[order[l]], vbls[order[l]]+nDimensions, &landmarks[l*nDimensions]);
+
+	// classical MDS of the landmarks: B = -1/2 * H * D2 * H
+	MatrixXd D2(nLandmarks, nLandmarks);
+	for (int i=0 ; i<nLandmarks ; i++)
+	{
+		D2(i,i) = 0.0;
+		for (int j=0 ; j<i ; j++)
+		{
+			double d2 = 0.0;
+			for (int d=0 ; d<nDimensions ; d++)
+			{
+				double delta = landmarks[i*nDimensions+d] - landmarks[j*nDimensions+d];
+				d2 += delta * delta;
+			}
+			D2(i,j) = D2(j,i) = d2;
+		}
+	}
+	VectorXd colMeans = D2.colwise().mean().transpose();
+	double grandMean = colMeans.mean();
+	MatrixXd B(nLandmarks, nLandmarks);
+	for (int i=0 ; i<nLandmarks ; i++)
+		for (int j=0 ; j<nLandmarks ; j++)
+			B(i,j) = -0.5 * (D2(i,j) - colMeans(i) - colMeans(j) + grandMean);
+
+	// eigenvalues are returned in increasing order
+	SelfAdjointEigenSolver<MatrixXd> solver(B);
+	meanSquaredDistance.assign(colMeans.data(), colMeans.data()+nLandmarks);
+	pseudoInverse.assign(nComponents * nLandmarks, 0.0);
+	for (int c=0 ; (c<nComponents) && (c<nLandmarks) ; c++)
+	{
+		double eigenValue = solver.eigenvalues()(nLandmarks-1-c);
+		if (eigenValue <= 1.0e-12)
+			break; // remaining components stay 0
+		VectorXd v = solver.eigenvectors().col(nLandmarks-1-c);
+		for (int l=0 ; l<nLandmarks ; l++)
+			pseudoInverse[c*nLandmarks + l] = v(l) / std::sqrt(eigenValue);
+	}
+}
+
+LandmarkMDS::~LandmarkMDS()
+{
+}
+
+void LandmarkMDS::reduce(float** vbls, int nDimensionsIn, int nSamples,
+	int nComponentsIn, float** result) const
+{
+	if (nDimensionsIn != nDimensions)
+	{
+		std::cerr << "LandmarkMDS::reduce: expected " << nDimensions
+		          << " dimensions, not " << nDimensionsIn << '\n';
+		return;
+	}
+	int nLandmarks = getNumLandmarks();
+	std::vector<double> delta(nLandmarks);
+	for (int s=0 ; s<nSamples ; s++)
+	{
+		const float* row = vbls[s];
+		// y = -1/2 * pseudoInverse * (squared distances - column means)
+		for (int l=0 ; l<nLandmarks ; l++)
+		{
+			const float* landmark = &landmarks[l*nDimensions];
+			double d2 = 0.0;
+			for (int d=0 ; d<nDimensions ; d++)
+			{
+				double diff = row[d] - landmark[d];
+				d2 += diff * diff;
+			}
+			delta[l] = d2 - meanSquaredDistance[l];
+		}
+		for (int c=0 ; c<nComponentsIn ; c++)
+		{
+			double y = 0.0;
+			if (c < nComponents)
+			{
+				const double* p = &pseudoInverse[c*nLandmarks];
+				for (int l=0 ; l<nLandmarks ; l++)
+					y += p[l] * delta[l];
+			}
+			result[s][c] = -0.5 * y;
+		}
+	}
+}
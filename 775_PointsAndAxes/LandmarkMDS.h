@@ -0,0 +1,40 @@
+// LandmarkMDS.h -- Landmark multidimensional scaling (de Silva & Tenenbaum,
+//                  2004). Classical MDS is solved only for a random subset of
+//                  "landmark" rows; every other row is placed by triangulating
+//                  from its squared distances to the landmarks, so the cost is
+//                  linear in the number of rows.
+
+#ifndef LANDMARKMDS_H
+#define LANDMARKMDS_H
+
+#include <vector>
+
+#include "Reducer.h"
+
+class LandmarkMDS : public Reducer
+{
+public:
+	// In following, each row is a sample; columns are dimensions
+	LandmarkMDS(float** vbls, int nDimensionsIn, int nSamples,
+		int nComponentsIn, int nLandmarks=DEFAULT_NUM_LANDMARKS, unsigned int seed=1);
+	virtual ~LandmarkMDS();
+
+	virtual const char* getName() const { return "landmark MDS"; }
+	virtual void reduce(float** vbls, int nDimensions, int nSamples,
+		int nComponents, float** result) const;
+
+	int getNumLandmarks() const { return landmarks.size() / nDimensions; }
+
+	static const int DEFAULT_NUM_LANDMARKS = 200;
+
+private:
+	int nDimensions, nComponents;
+	// the landmark rows, each stored contiguously
+	std::vector<float> landmarks;
+	// column means of the squared landmark distance matrix
+	std::vector<double> meanSquaredDistance;
+	// nComponents rows of nLandmarks: eigenvector/sqrt(eigenvalue)
+	std::vector<double> pseudoInverse;
+};
+
+#endif
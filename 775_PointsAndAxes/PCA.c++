@@ -1,17 +1,41 @@
 // PCA.c++ -- This class was derived from pca_eigen.cpp, downloaded 2014/02/11 from:
 // http://codingplayground.blogspot.com/2010/01/pca-dimensional-reduction-in-eigen.html
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <random>
 
 #include "PCA.h"
 using namespace Eigen;
 
 bool PCA::debug = false;
+bool PCA::mixedPrecision = false;
+
+// samples per float block in mixed precision mode; small enough that float
+// sums over a block lose little, large enough to amortize the double sums
+static const int BLOCK_SIZE = 256;
+
+// Kahan-compensated sum += x
+static inline void kahanAdd(double& sum, double& compensation, double x)
+{
+	double y = x - compensation;
+	double t = sum + y;
+	compensation = (t - sum) - y;
+	sum = t;
+}
 
 // In following, each row is a sample; columns are dimensions
 PCA::PCA(float** vbls, int nDimensionsIn, int nSamplesIn) :
 	nDimensions(nDimensionsIn), nSamples(nSamplesIn)
 {
+	if (mixedPrecision)
+	{
+		MatrixXd Covariance;
+		computeCovarianceMixed(vbls, nDimensions, nSamples, Covariance);
+		solve(Covariance);
+		return;
+	}
 	//                                   ROWS:        COLS:
 	MatrixXd DataPoints = MatrixXd::Zero(nDimensions, nSamples);
 	for (int d=0 ; d<nDimensions ; d++)
@@ -24,6 +48,17 @@ PCA::PCA(float** vbls, int nDimensionsIn, int nSamplesIn) :
 	finishConstruction(DataPoints);
 }
 
+PCA::PCA(const MatrixXd& fullCovariance, const std::vector<int>& subset,
+		int nSamplesIn) :
+	nDimensions(subset.size()), nSamples(nSamplesIn)
+{
+	MatrixXd Covariance(nDimensions, nDimensions);
+	for (int i=0 ; i<nDimensions ; i++)
+		for (int j=0 ; j<nDimensions ; j++)
+			Covariance(i,j) = fullCovariance(subset[i], subset[j]);
+	solve(Covariance);
+}
+
 // The following is only inteded for subclasses that will call
 // finishConstruction themselves.
 PCA::PCA(int nDimensionsIn, int nSamplesIn) :
@@ -31,6 +66,241 @@ PCA::PCA(int nDimensionsIn, int nSamplesIn) :
 {
 }
 
+void PCA::computeCovariance(float** vbls, int nDimensions, int nSamples,
+	MatrixXd& covariance) // CLASS METHOD
+{
+	if (mixedPrecision)
+	{
+		computeCovarianceMixed(vbls, nDimensions, nSamples, covariance);
+		return;
+	}
+	MatrixXd DataPoints = MatrixXd::Zero(nDimensions, nSamples);
+	for (int d=0 ; d<nDimensions ; d++)
+	{
+		for (int s=0 ; s<nSamples ; s++)
+		{
+			DataPoints(d,s) = vbls[s][d];
+		}
+	}
+	for (int i = 0; i < nDimensions; i++)
+	{
+		double mean = (DataPoints.row(i).sum())/nSamples;
+		DataPoints.row(i) -= VectorXd::Constant(nSamples,mean);
+	}
+	covariance = (1 / (double) nSamples) * DataPoints * DataPoints.transpose();
+}
+
+void PCA::computeCovarianceMixed(float** vbls, int nDimensions, int nSamples,
+	MatrixXd& covariance) // CLASS METHOD
+{
+	int n = nDimensions;
+
+	// means
+	std::vector<float> blockSum(n);
+	std::vector<double> sum(n, 0.0), sumCompensation(n, 0.0);
+	for (int b=0 ; b<nSamples ; b+=BLOCK_SIZE)
+	{
+		int bEnd = std::min(b+BLOCK_SIZE, nSamples);
+		std::fill(blockSum.begin(), blockSum.end(), 0.0f);
+		for (int s=b ; s<bEnd ; s++)
+			for (int d=0 ; d<n ; d++)
+				blockSum[d] += vbls[s][d];
+		for (int d=0 ; d<n ; d++)
+			kahanAdd(sum[d], sumCompensation[d], blockSum[d]);
+	}
+	std::vector<float> mean(n);
+	for (int d=0 ; d<n ; d++)
+		mean[d] = sum[d] / nSamples;
+
+	// upper triangle of the sums of products of the centered values
+	std::vector<float> block(BLOCK_SIZE * n);
+	std::vector<float> blockProducts(n * n);
+	std::vector<double> products(n * n, 0.0), productsCompensation(n * n, 0.0);
+	for (int b=0 ; b<nSamples ; b+=BLOCK_SIZE)
+	{
+		int bEnd = std::min(b+BLOCK_SIZE, nSamples);
+		for (int s=b ; s<bEnd ; s++)
+			for (int d=0 ; d<n ; d++)
+				block[(s-b)*n + d] = vbls[s][d] - mean[d];
+		std::fill(blockProducts.begin(), blockProducts.end(), 0.0f);
+		for (int s=0 ; s<bEnd-b ; s++)
+		{
+			const float* x = &block[s*n];
+			for (int i=0 ; i<n ; i++)
+			{
+				float xi = x[i];
+				float* row = &blockProducts[i*n];
+				for (int j=i ; j<n ; j++)
+					row[j] += xi * x[j];
+			}
+		}
+		for (int i=0 ; i<n ; i++)
+			for (int j=i ; j<n ; j++)
+				kahanAdd(products[i*n+j], productsCompensation[i*n+j], blockProducts[i*n+j]);
+	}
+
+	covariance.resize(n, n);
+	for (int i=0 ; i<n ; i++)
+		for (int j=i ; j<n ; j++)
+			covariance(i,j) = covariance(j,i) = products[i*n+j] / nSamples;
+}
+
+void PCA::computeMCDCovariance(float** vbls, const unsigned char* missing,
+	int nDimensions, int nSamples, int subsampleSize, MatrixXd& covariance)
+	// CLASS METHOD
+{
+	int n = nDimensions;
+	std::mt19937 generator(1);
+
+	// a random subsample of the complete samples
+	std::vector<int> complete;
+	for (int s=0 ; s<nSamples ; s++)
+	{
+		bool ok = true;
+		for (int d=0 ; (d<n) && ok && (missing != NULL) ; d++)
+			ok = (missing[s*n + d] == 0);
+		if (ok)
+			complete.push_back(s);
+	}
+	int m = std::min((int)complete.size(), subsampleSize);
+	for (int i=0 ; i<m ; i++)
+	{
+		std::uniform_int_distribution<int> pick(i, complete.size()-1);
+		std::swap(complete[i], complete[pick(generator)]);
+	}
+	if (m <= n)
+	{
+		std::cerr << "PCA::computeMCDCovariance: only " << m << " complete samples;"
+		          << " using the classical covariance.\n";
+		computePairwiseCovariance(vbls, missing, nDimensions, nSamples, covariance);
+		return;
+	}
+	MatrixXd X(m, n);
+	for (int i=0 ; i<m ; i++)
+		for (int d=0 ; d<n ; d++)
+			X(i,d) = vbls[complete[i]][d];
+
+	// Each start is a random (n+1)-subset, refined with C-steps: take the h
+	// samples with the smallest Mahalanobis distances under the current
+	// estimate; this never increases the determinant.
+	const int N_STARTS = 10, MAX_C_STEPS = 20;
+	const double RIDGE = 1.0e-9; // keeps constant dimensions from making it singular
+	int h = (m + n + 1) / 2;
+	std::vector<int> order(m);
+	double bestLogDet = 0.0;
+	VectorXd bestMean;
+	MatrixXd bestCov;
+	for (int start=0 ; start<N_STARTS ; start++)
+	{
+		for (int i=0 ; i<m ; i++)
+			order[i] = i;
+		std::shuffle(order.begin(), order.end(), generator);
+		int size = n + 1;
+		double logDet = 0.0, lastLogDet = 0.0;
+		VectorXd mean;
+		MatrixXd cov;
+		for (int step=0 ; step<MAX_C_STEPS ; step++)
+		{
+			mean = VectorXd::Zero(n);
+			for (int i=0 ; i<size ; i++)
+				mean += X.row(order[i]).transpose();
+			mean /= size;
+			cov = MatrixXd::Zero(n, n);
+			for (int i=0 ; i<size ; i++)
+			{
+				VectorXd x = X.row(order[i]).transpose() - mean;
+				cov += x * x.transpose();
+			}
+			cov = cov / size + RIDGE * MatrixXd::Identity(n, n);
+			LDLT<MatrixXd> ldlt(cov);
+			logDet = ldlt.vectorD().array().abs().log().sum();
+			if ((step > 0) && (std::fabs(lastLogDet - logDet) < 1.0e-10))
+				break;
+			lastLogDet = logDet;
+			std::vector<std::pair<double,int> > d2(m);
+			for (int i=0 ; i<m ; i++)
+			{
+				VectorXd x = X.row(i).transpose() - mean;
+				d2[i] = std::make_pair(x.dot(ldlt.solve(x)), i);
+			}
+			std::nth_element(d2.begin(), d2.begin()+h, d2.end());
+			for (int i=0 ; i<h ; i++)
+				order[i] = d2[i].second;
+			size = h;
+		}
+		if ((start == 0) || (logDet < bestLogDet))
+		{
+			bestLogDet = logDet;
+			bestMean = mean;
+			bestCov = cov;
+		}
+	}
+
+	// scale for consistency with the classical estimate under normality:
+	// the median squared distance should be the chi-square(n) median
+	LDLT<MatrixXd> ldlt(bestCov);
+	std::vector<double> d2(m);
+	for (int i=0 ; i<m ; i++)
+	{
+		VectorXd x = X.row(i).transpose() - bestMean;
+		d2[i] = x.dot(ldlt.solve(x));
+	}
+	std::nth_element(d2.begin(), d2.begin()+m/2, d2.end());
+	double chiSquareMedian = n * std::pow(1.0 - 2.0/(9.0*n), 3.0);
+	covariance = bestCov * (d2[m/2] / chiSquareMedian);
+}
+
+void PCA::computePairwiseCovariance(float** vbls, const unsigned char* missing,
+	int nDimensions, int nSamples, MatrixXd& covariance) // CLASS METHOD
+{
+	if (missing == NULL)
+	{
+		computeCovariance(vbls, nDimensions, nSamples, covariance);
+		return;
+	}
+	// For each pair, sums over the samples where both are present. Values
+	// are shifted by the first sample's to keep the one-pass sums accurate.
+	int n = nDimensions;
+	std::vector<double> count(n*n, 0.0), sumX(n*n, 0.0), sumY(n*n, 0.0), sumXY(n*n, 0.0);
+	std::vector<double> shift(n, 0.0);
+	for (int d=0 ; d<n ; d++)
+		for (int s=0 ; s<nSamples ; s++)
+			if (missing[s*n + d] == 0)
+			{
+				shift[d] = vbls[s][d];
+				break;
+			}
+	for (int s=0 ; s<nSamples ; s++)
+	{
+		const unsigned char* m = &missing[s*n];
+		for (int i=0 ; i<n ; i++)
+		{
+			if (m[i] != 0)
+				continue;
+			double x = vbls[s][i] - shift[i];
+			for (int j=i ; j<n ; j++)
+			{
+				if (m[j] != 0)
+					continue;
+				double y = vbls[s][j] - shift[j];
+				count[i*n+j] += 1.0;
+				sumX[i*n+j] += x;
+				sumY[i*n+j] += y;
+				sumXY[i*n+j] += x * y;
+			}
+		}
+	}
+	covariance.resize(n, n);
+	for (int i=0 ; i<n ; i++)
+		for (int j=i ; j<n ; j++)
+		{
+			int k = i*n + j;
+			double c = (count[k] > 0.0) ?
+				(sumXY[k] - sumX[k]*sumY[k]/count[k]) / count[k] : 0.0;
+			covariance(i,j) = covariance(j,i) = c;
+		}
+}
+
 void PCA::finishConstruction(MatrixXd& DataPoints)
 {
 	double mean;
@@ -50,6 +320,11 @@ void PCA::finishConstruction(MatrixXd& DataPoints)
 	// get the covariance matrix
 	MatrixXd Covariance = MatrixXd::Zero(nDimensions, nDimensions);
 	Covariance = (1 / (double) nSamples) * DataPoints * DataPoints.transpose();
+	solve(Covariance);
+}
+
+void PCA::solve(const MatrixXd& Covariance)
+{
 	if (debug)
 		std::cout << "Covariance matrix:\n" << Covariance;	
 
@@ -113,6 +388,45 @@ void PCA::getIthLargestEigenValueEigenVector(int i, float& eigenValue, float* ei
 		eigenVector[i] = eigenVectors.col(pi[piLoc].second)(i);
 }
 
+void PCA::getIthLargestEigenValueEigenVector(int i, double& eigenValue, double* eigenVector) const
+{
+	if ((i < 0) || (i >= nDimensions))
+		return;
+	int piLoc = pi.size()-1-i;
+	eigenValue = pi[piLoc].first;
+	for (int i=0 ; i<nDimensions ; i++)
+		eigenVector[i] = eigenVectors.col(pi[piLoc].second)(i);
+}
+
+void PCA::reduce(float** vbls, int nDimensionsIn, int nSamplesIn,
+	int nComponents, float** result) const
+{
+	if (nDimensionsIn != nDimensions)
+	{
+		std::cerr << "PCA::reduce: expected " << nDimensions
+		          << " dimensions, not " << nDimensionsIn << '\n';
+		return;
+	}
+	int largest = pi.size() - 1;
+	for (int c=0 ; c<nComponents ; c++)
+	{
+		if (c >= nDimensions)
+		{
+			for (int s=0 ; s<nSamplesIn ; s++)
+				result[s][c] = 0.0;
+			continue;
+		}
+		VectorXd eigenVector = eigenVectors.col(pi[largest-c].second);
+		for (int s=0 ; s<nSamplesIn ; s++)
+		{
+			double sum = 0.0;
+			for (int d=0 ; d<nDimensions ; d++)
+				sum += vbls[s][d] * eigenVector(d);
+			result[s][c] = sum;
+		}
+	}
+}
+
 PCA::~PCA()
 {
 }
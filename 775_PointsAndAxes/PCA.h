@@ -8,22 +8,54 @@
 #include "Eigen/Core"
 #include "Eigen/Eigen"
 
+#include "Reducer.h"
+
 typedef std::pair<double, int> myPair;
 typedef std::vector<myPair> PermutationIndices;
 
-class PCA
+class PCA : public Reducer
 {
 public:
 	// In following, each row is a sample; columns are dimensions
 	PCA(float** vbls, int nDimensionsIn, int nSamplesIn);
+	// PCA of just the variables in "subset" (0-based row/column indices into
+	// a covariance matrix of all variables such as computeCovariance builds).
+	// Only the corresponding submatrix is eigen-solved.
+	PCA(const Eigen::MatrixXd& fullCovariance, const std::vector<int>& subset,
+		int nSamplesIn);
 	virtual ~PCA();
 
+	// covariance: (nDimensions x nDimensions) covariance of the columns of vbls
+	static void computeCovariance(float** vbls, int nDimensions, int nSamples,
+		Eigen::MatrixXd& covariance);
+	// As above, but values whose missing[sample*nDimensions + dimension] is
+	// nonzero are skipped: each entry uses just the samples where both of
+	// its dimensions are present ("pairwise complete").
+	static void computePairwiseCovariance(float** vbls, const unsigned char* missing,
+		int nDimensions, int nSamples, Eigen::MatrixXd& covariance);
+	// Outlier-resistant covariance: the minimum covariance determinant
+	// estimate (FAST-MCD C-steps) over a random subsample of at most
+	// subsampleSize complete samples. "missing" may be NULL.
+	static void computeMCDCovariance(float** vbls, const unsigned char* missing,
+		int nDimensions, int nSamples, int subsampleSize, Eigen::MatrixXd& covariance);
+
 	// i=0 ==> largest; i==1 ==> next largest; etc.
 	void getIthLargestEigenValueEigenVector(int i, float& eigenValue, float* eigenVector) const;
+	void getIthLargestEigenValueEigenVector(int i, double& eigenValue, double* eigenVector) const;
 	int getNumDimensions() const { return nDimensions; }
 	int getNumSamples() const { return nSamples; }
 
+	virtual const char* getName() const { return "PCA"; }
+	// Project onto the nComponents largest eigenvectors (uncentered)
+	virtual void reduce(float** vbls, int nDimensions, int nSamples,
+		int nComponents, float** result) const;
+
 	static void setDebug(bool b) { debug = b; }
+	// In mixed precision mode, the covariance (whether built by the vbls
+	// constructor or computeCovariance) is accumulated in float over blocks
+	// of samples, and only the block sums and the eigen-solve use double.
+	static void setMixedPrecision(bool b) { mixedPrecision = b; }
+	static bool getMixedPrecision() { return mixedPrecision; }
 
 protected:
 	// Useful only for subclasses that are going to fill the MatrixXd
@@ -31,8 +63,13 @@ protected:
 	PCA(int nDimensionsIn, int nSamplesIn);
 	int nDimensions, nSamples;
 	void finishConstruction(Eigen::MatrixXd& DataPoints);
+	void solve(const Eigen::MatrixXd& Covariance);
 
 	static bool debug;
+	static bool mixedPrecision;
+
+	static void computeCovarianceMixed(float** vbls, int nDimensions, int nSamples,
+		Eigen::MatrixXd& covariance);
 
 private:
 	PermutationIndices pi;
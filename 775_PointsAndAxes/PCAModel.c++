@@ -0,0 +1,237 @@
+// PCAModel.c++ -- A PCA basis and its normalization, stored in a binary file
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <fstream>
+
+#include "PCAModel.h"
+#include "DataSet.h"
+#include "PCA.h"
+
+// File layout (native byte order):
+//   char[4] "PCAM"; int version; int nVariables; int nSamples
+//   per variable: int nameLength; char name[nameLength]; double alpha, beta, mean;
+//                 int nCategories; float categories[nCategories], encoded[nCategories]
+//                 (version 2 on; nCategories is 0 unless target encoded)
+//   double eigenValues[nVariables]  (largest first)
+//   double eigenVectors[nVariables][nVariables]  (one eigenvector per row)
+static const char MAGIC[4] = { 'P', 'C', 'A', 'M' };
+static const int VERSION = 2;
+// Limits on the lengths read, so that a corrupt file cannot ask for huge
+// allocations. No category table is larger than a 16-bit code can index.
+static const int MAX_NAME_LENGTH = 4096;
+static const int MAX_CATEGORIES = 65536;
+static const int MAX_VARIABLES = 65536;
+
+PCAModel::PCAModel(const DataSet& data, const std::vector<int>& subset, const PCA& pca) :
+	nVariables(subset.size()), nSamples(data.getNumRows()),
+	eigenValues(subset.size()), eigenVectors(subset.size()*subset.size())
+{
+	const Variable* vars = data.getVariables();
+	for (int i=0 ; i<nVariables ; i++)
+	{
+		const Variable& v = vars[subset[i]];
+		names.push_back(v.name);
+		alpha.push_back(v.alpha);
+		beta.push_back(v.beta);
+		mean.push_back(v.alpha * v.mean + v.beta);
+		categories.push_back(v.encoded.empty() ? std::vector<float>() : v.categories);
+		encoded.push_back(v.encoded);
+	}
+	for (int c=0 ; c<nVariables ; c++)
+		pca.getIthLargestEigenValueEigenVector(c, eigenValues[c], &eigenVectors[c*nVariables]);
+}
+
+PCAModel::PCAModel(int nVariablesIn, int nSamplesIn) :
+	nVariables(nVariablesIn), nSamples(nSamplesIn),
+	names(nVariablesIn), alpha(nVariablesIn), beta(nVariablesIn), mean(nVariablesIn),
+	categories(nVariablesIn), encoded(nVariablesIn),
+	eigenValues(nVariablesIn),
+	eigenVectors(static_cast<size_t>(nVariablesIn) * nVariablesIn)
+{
+}
+
+PCAModel::~PCAModel()
+{
+}
+
+bool PCAModel::findSubset(const DataSet& data, std::vector<int>& subset) const
+{
+	subset.clear();
+	for (int i=0 ; i<nVariables ; i++)
+	{
+		int index = data.getVariableIndex(names[i]);
+		if (index < 0)
+		{
+			std::cerr << "PCAModel::findSubset: data set has no variable named '"
+			          << names[i] << "'\n";
+			return false;
+		}
+		subset.push_back(index);
+	}
+	return true;
+}
+
+void PCAModel::project(const DataSet& data, const std::vector<int>& subset,
+	cryph::Point3f* pts, float* sps, float* sz, float* crs) const
+{
+	// components beyond the number of variables are 0
+	int nComponents = (nVariables < 6) ? nVariables : 6;
+	const Variable* vars = data.getVariables();
+	std::vector<double> normalized(nVariables);
+	for (int i=0 ; i<data.getNumRows() ; i++)
+	{
+		for (int j=0 ; j<nVariables ; j++)
+			normalized[j] = normalize(j, vars[subset[j]].getValue(i));
+		double projected[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+		for (int c=0 ; c<nComponents ; c++)
+		{
+			const double* eigenVector = &eigenVectors[c*nVariables];
+			for (int j=0 ; j<nVariables ; j++)
+				projected[c] += normalized[j] * eigenVector[j];
+		}
+		pts[i] = cryph::Point3f(projected[0], projected[1], projected[2]);
+		sps[i] = projected[3];
+		sz[i] = projected[4];
+		crs[i] = projected[5];
+	}
+}
+
+double PCAModel::normalize(int j, float value) const
+{
+	// missing values (and unknown categories) are replaced by the model's mean
+	if (std::isnan(value))
+		return mean[j];
+	if (categories[j].empty())
+		return alpha[j] * value + beta[j];
+	std::vector<float>::const_iterator it =
+		std::lower_bound(categories[j].begin(), categories[j].end(), value);
+	if ((it == categories[j].end()) || (*it != value))
+		return mean[j];
+	return encoded[j][it - categories[j].begin()];
+}
+
+PCAModel* PCAModel::read(const std::string& fileName) // CLASS METHOD
+{
+	std::ifstream is(fileName.c_str(), std::ios::binary);
+	if (!is.good())
+	{
+		std::cerr << "PCAModel::read: could not open " << fileName << " for reading.\n";
+		return NULL;
+	}
+	char magic[4];
+	int version, nVars, nSamp;
+	is.read(magic, 4);
+	is.read(reinterpret_cast<char*>(&version), sizeof(int));
+	is.read(reinterpret_cast<char*>(&nVars), sizeof(int));
+	is.read(reinterpret_cast<char*>(&nSamp), sizeof(int));
+	if (!is.good() || !std::equal(magic, magic+4, MAGIC) || (version < 1) || (version > VERSION) ||
+		(nVars <= 0) || (nVars > MAX_VARIABLES) || (nSamp < 0))
+	{
+		std::cerr << "PCAModel::read: " << fileName << " is not a PCA model file.\n";
+		return NULL;
+	}
+	// Even with empty names and no categories, the rest of the file needs
+	// this many bytes; checking first keeps a truncated or corrupt header
+	// from asking for the eigenvectors of nVars variables.
+	size_t perVariable = sizeof(int) + 3*sizeof(double) + ((version >= 2) ? sizeof(int) : 0);
+	size_t needed = static_cast<size_t>(nVars) * (perVariable + sizeof(double)) +
+		static_cast<size_t>(nVars) * nVars * sizeof(double);
+	std::streampos start = is.tellg();
+	is.seekg(0, std::ios::end);
+	std::streamoff remaining = is.tellg() - start;
+	is.seekg(start);
+	if (!is.good() || (remaining < 0) || (static_cast<size_t>(remaining) < needed))
+	{
+		std::cerr << "PCAModel::read: " << fileName << " is truncated.\n";
+		return NULL;
+	}
+
+	PCAModel* m = new PCAModel(nVars, nSamp);
+	for (int i=0 ; (i<nVars) && is.good() ; i++)
+	{
+		int nameLength = 0;
+		is.read(reinterpret_cast<char*>(&nameLength), sizeof(int));
+		if (!is.good())
+			break; // reported as truncated below
+		if ((nameLength < 0) || (nameLength > MAX_NAME_LENGTH))
+		{
+			std::cerr << "PCAModel::read: " << fileName << " is not a PCA model file.\n";
+			delete m;
+			return NULL;
+		}
+		m->names[i].resize(nameLength);
+		if (nameLength > 0)
+			is.read(&m->names[i][0], nameLength);
+		is.read(reinterpret_cast<char*>(&m->alpha[i]), sizeof(double));
+		is.read(reinterpret_cast<char*>(&m->beta[i]), sizeof(double));
+		is.read(reinterpret_cast<char*>(&m->mean[i]), sizeof(double));
+		int nCategories = 0;
+		if (version >= 2)
+			is.read(reinterpret_cast<char*>(&nCategories), sizeof(int));
+		if (!is.good())
+			break; // reported as truncated below
+		if ((nCategories < 0) || (nCategories > MAX_CATEGORIES))
+		{
+			std::cerr << "PCAModel::read: " << fileName << " is not a PCA model file.\n";
+			delete m;
+			return NULL;
+		}
+		m->categories[i].resize(nCategories);
+		m->encoded[i].resize(nCategories);
+		if (nCategories > 0)
+		{
+			is.read(reinterpret_cast<char*>(&m->categories[i][0]), nCategories*sizeof(float));
+			is.read(reinterpret_cast<char*>(&m->encoded[i][0]), nCategories*sizeof(float));
+		}
+	}
+	is.read(reinterpret_cast<char*>(&m->eigenValues[0]), nVars*sizeof(double));
+	is.read(reinterpret_cast<char*>(&m->eigenVectors[0]), m->eigenVectors.size()*sizeof(double));
+	if (!is.good())
+	{
+		std::cerr << "PCAModel::read: " << fileName << " is truncated.\n";
+		delete m;
+		return NULL;
+	}
+	return m;
+}
+
+bool PCAModel::write(const std::string& fileName) const
+{
+	std::ofstream os(fileName.c_str(), std::ios::binary);
+	if (!os.good())
+	{
+		std::cerr << "PCAModel::write: could not open " << fileName << " for writing.\n";
+		return false;
+	}
+	os.write(MAGIC, 4);
+	os.write(reinterpret_cast<const char*>(&VERSION), sizeof(int));
+	os.write(reinterpret_cast<const char*>(&nVariables), sizeof(int));
+	os.write(reinterpret_cast<const char*>(&nSamples), sizeof(int));
+	for (int i=0 ; i<nVariables ; i++)
+	{
+		int nameLength = names[i].length();
+		os.write(reinterpret_cast<const char*>(&nameLength), sizeof(int));
+		os.write(names[i].data(), nameLength);
+		os.write(reinterpret_cast<const char*>(&alpha[i]), sizeof(double));
+		os.write(reinterpret_cast<const char*>(&beta[i]), sizeof(double));
+		os.write(reinterpret_cast<const char*>(&mean[i]), sizeof(double));
+		int nCategories = categories[i].size();
+		os.write(reinterpret_cast<const char*>(&nCategories), sizeof(int));
+		if (nCategories > 0)
+		{
+			os.write(reinterpret_cast<const char*>(&categories[i][0]), nCategories*sizeof(float));
+			os.write(reinterpret_cast<const char*>(&encoded[i][0]), nCategories*sizeof(float));
+		}
+	}
+	os.write(reinterpret_cast<const char*>(&eigenValues[0]), nVariables*sizeof(double));
+	os.write(reinterpret_cast<const char*>(&eigenVectors[0]),
+		nVariables*nVariables*sizeof(double));
+	if (!os.good())
+	{
+		std::cerr << "PCAModel::write: error writing " << fileName << '\n';
+		return false;
+	}
+	return true;
+}
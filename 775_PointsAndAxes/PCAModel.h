@@ -0,0 +1,62 @@
+// PCAModel.h -- A PCA basis together with the normalization it was computed
+//               under, stored in a small binary file so that other OKC files
+//               with the same variables can be projected into the same
+//               coordinate frame without recomputing the PCA.
+
+#ifndef PCAMODEL_H
+#define PCAMODEL_H
+
+#include <string>
+#include <vector>
+
+#include "Point3.h"
+
+class DataSet;
+class PCA;
+
+class PCAModel
+{
+public:
+	// "subset" holds the 0-based indices into "data" of the variables
+	// "pca" was computed from.
+	PCAModel(const DataSet& data, const std::vector<int>& subset, const PCA& pca);
+	virtual ~PCAModel();
+
+	// Returns NULL (after reporting why) if the file cannot be read
+	static PCAModel* read(const std::string& fileName);
+	bool write(const std::string& fileName) const;
+
+	int getNumVariables() const { return nVariables; }
+	int getNumSamples() const { return nSamples; }
+	// i=0 ==> largest; i==1 ==> next largest; etc.
+	double getIthLargestEigenValue(int i) const { return eigenValues[i]; }
+	const double* getIthLargestEigenVector(int i) const
+		{ return &eigenVectors[i*nVariables]; }
+
+	// Find the variables of "data" with the names this model was built
+	// from; returns false if any is missing.
+	bool findSubset(const DataSet& data, std::vector<int>& subset) const;
+	// Same contract as DataSet::project, except that the stored alpha/beta
+	// are used to normalize the values of "data".
+	void project(const DataSet& data, const std::vector<int>& subset,
+		cryph::Point3f* pts, float* sps, float* sz, float* crs) const;
+
+private:
+	PCAModel(int nVariablesIn, int nSamplesIn);
+	PCAModel(const PCAModel& m) {} // do not allow copies
+
+	double normalize(int j, float value) const;
+
+	int nVariables, nSamples;
+	std::vector<std::string> names;
+	// per variable; "mean" is the mean of the normalized values
+	std::vector<double> alpha, beta, mean;
+	// per variable: for target-encoded categorical variables, their sorted
+	// categories and the normalized value of each; otherwise empty
+	std::vector<std::vector<float> > categories, encoded;
+	// sorted from largest to smallest; eigenVectors holds one per variable,
+	// each stored contiguously
+	std::vector<double> eigenValues, eigenVectors;
+};
+
+#endif
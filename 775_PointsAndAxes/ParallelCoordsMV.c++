@@ -0,0 +1,352 @@
+// ParallelCoordsMV.c++
+
+#include <iostream>
+
+#include "ParallelCoordsMV.h"
+#include "DataSet.h"
+#include "ShaderIF.h"
+
+ShaderIF* ParallelCoordsMV::shaderIF = NULL;
+ShaderIF* ParallelCoordsMV::densityShaderIF = NULL;
+int ParallelCoordsMV::numInstances = 0;
+GLuint ParallelCoordsMV::shaderProgram = 0;
+GLuint ParallelCoordsMV::densityShaderProgram = 0;
+GLint ParallelCoordsMV::ppuLoc_color = -1;
+GLint ParallelCoordsMV::ppuLoc_values = -1;
+GLint ParallelCoordsMV::ppuLoc_axisVariable = -1;
+GLint ParallelCoordsMV::ppuLoc_nVariables = -1;
+GLint ParallelCoordsMV::ppuLoc_nAxes = -1;
+GLint ParallelCoordsMV::ppuLoc_drawAxes = -1;
+GLint ParallelCoordsMV::ppuLoc_ldsBounds = -1;
+GLint ParallelCoordsMV::ppuLoc_density = -1;
+GLint ParallelCoordsMV::ppuLoc_nRows = -1;
+
+// The LDS rectangle spanned by the axes: {xmin, xmax, ymin, ymax}
+static const float LDS_BOUNDS[4] = { -0.9, 0.9, -0.85, 0.85 };
+
+// Polylines are drawn with an opacity of about this many rows' worth
+// divided by the number of rows (so that dense regions still saturate).
+static const float OPAQUE_ROWS = 50.0;
+static const float MIN_LINE_ALPHA = 0.02;
+
+ParallelCoordsMV::ParallelCoordsMV(const DataSet& data) :
+	nRows(data.getNumRows()), nVariables(data.getNumVariables()), vars(data.getVariables()),
+	axisOrderChanged(true), densityEnabled(data.getNumRows() > DENSITY_THRESHOLD),
+	densityFBO(0), densityTexture(0), densityWidth(0), densityHeight(0)
+{
+	if (ParallelCoordsMV::shaderProgram == 0)
+	{
+		// create the shader programs:
+		ParallelCoordsMV::shaderIF = new ShaderIF("ParallelCoordsMV.vsh", "AxesMV.fsh");
+		ParallelCoordsMV::shaderProgram = shaderIF->getShaderPgmID();
+		ParallelCoordsMV::densityShaderIF =
+			new ShaderIF("ParallelCoordsDensity.vsh", "ParallelCoordsDensity.fsh");
+		ParallelCoordsMV::densityShaderProgram = densityShaderIF->getShaderPgmID();
+		fetchGLSLVariableLocations();
+	}
+
+	lineAlpha = (nRows > 0) ? OPAQUE_ROWS / nRows : 1.0;
+	if (lineAlpha > 1.0)
+		lineAlpha = 1.0;
+	else if (lineAlpha < MIN_LINE_ALPHA)
+		lineAlpha = MIN_LINE_ALPHA;
+
+	// Now do instance-specific initialization:
+	defineModel(data);
+	ParallelCoordsMV::numInstances++;
+}
+
+ParallelCoordsMV::~ParallelCoordsMV()
+{
+	glDeleteTextures(1, &valueTexture);
+	glDeleteTextures(1, &axisTexture);
+	glDeleteBuffers(1, &valueBuffer);
+	glDeleteBuffers(1, &axisBuffer);
+	glDeleteBuffers(1, &indexBuffer);
+	glDeleteVertexArrays(1, vao);
+	if (densityFBO > 0)
+	{
+		glDeleteFramebuffers(1, &densityFBO);
+		glDeleteTextures(1, &densityTexture);
+	}
+	if (--ParallelCoordsMV::numInstances == 0)
+	{
+		ParallelCoordsMV::shaderIF->destroy();
+		delete ParallelCoordsMV::shaderIF;
+		ParallelCoordsMV::shaderIF = NULL;
+		ParallelCoordsMV::shaderProgram = 0;
+		ParallelCoordsMV::densityShaderIF->destroy();
+		delete ParallelCoordsMV::densityShaderIF;
+		ParallelCoordsMV::densityShaderIF = NULL;
+		ParallelCoordsMV::densityShaderProgram = 0;
+	}
+}
+
+void ParallelCoordsMV::defineDensityFBO(int width, int height)
+{
+	if (densityFBO == 0)
+	{
+		glGenFramebuffers(1, &densityFBO);
+		glGenTextures(1, &densityTexture);
+	}
+	glBindTexture(GL_TEXTURE_2D, densityTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, densityFBO);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+		GL_TEXTURE_2D, densityTexture, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cerr << "ParallelCoordsMV::defineDensityFBO: incomplete framebuffer\n";
+
+	densityWidth = width;
+	densityHeight = height;
+}
+
+void ParallelCoordsMV::defineModel(const DataSet& data)
+{
+	// The normalized values, one row after another. This is the only time
+	// they are sent to the GPU.
+	float* values = new float[nRows*nVariables];
+	for (int j=0 ; j<nVariables ; j++)
+		data.getNormalizedValues(j, &values[j], nVariables);
+
+	// Core profile drawing requires a VAO even though the shader has no
+	// attributes; it also records the shared index buffer.
+	glGenVertexArrays(1, vao);
+	glBindVertexArray(vao[0]);
+
+	GLuint* indices = new GLuint[nVariables];
+	for (int j=0 ; j<nVariables ; j++)
+		indices[j] = j;
+	glGenBuffers(1, &indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, nVariables*sizeof(GLuint), indices, GL_STATIC_DRAW);
+	delete [] indices;
+
+	glGenBuffers(1, &valueBuffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, valueBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, nRows*nVariables*sizeof(float), values, GL_STATIC_DRAW);
+	glGenTextures(1, &valueTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, valueTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, valueBuffer);
+	delete [] values;
+
+	for (int j=0 ; j<nVariables ; j++)
+		axisOrder.push_back(j);
+	glGenBuffers(1, &axisBuffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, axisBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, nVariables*sizeof(GLint), NULL, GL_DYNAMIC_DRAW);
+	glGenTextures(1, &axisTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, axisTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_R32I, axisBuffer);
+
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	glBindVertexArray(0);
+}
+
+// Draws one polyline per row with the current program, VAO
+// and textures.
+void ParallelCoordsMV::drawLines(const float* color)
+{
+	int nAxes = axisOrder.size();
+	glUniform4fv(ppuLoc_color, 1, color);
+	glUniform1i(ppuLoc_drawAxes, 0);
+	glDrawElementsInstanced(GL_LINE_STRIP, nAxes, GL_UNSIGNED_INT, 0, nRows);
+}
+
+void ParallelCoordsMV::fetchGLSLVariableLocations()
+{
+	if (ParallelCoordsMV::shaderProgram > 0)
+	{
+		ppuLoc_color = ppUniformLocation(shaderProgram, "color");
+		ppuLoc_values = ppUniformLocation(shaderProgram, "values");
+		ppuLoc_axisVariable = ppUniformLocation(shaderProgram, "axisVariable");
+		ppuLoc_nVariables = ppUniformLocation(shaderProgram, "nVariables");
+		ppuLoc_nAxes = ppUniformLocation(shaderProgram, "nAxes");
+		ppuLoc_drawAxes = ppUniformLocation(shaderProgram, "drawAxes");
+		ppuLoc_ldsBounds = ppUniformLocation(shaderProgram, "ldsBounds");
+	}
+	if (ParallelCoordsMV::densityShaderProgram > 0)
+	{
+		ppuLoc_density = ppUniformLocation(densityShaderProgram, "density");
+		ppuLoc_nRows = ppUniformLocation(densityShaderProgram, "nRows");
+	}
+}
+
+// xyzLimits: {mcXmin, mcXmax, mcYmin, mcYmax, mcZmin, mcZmax}
+void ParallelCoordsMV::getMCBoundingBox(double* xyzLimits) const
+{
+	// An empty box (min > max), so that the overall box is determined by
+	// the 3D models alone.
+	for (int i=0 ; i<6 ; i+=2)
+	{
+		xyzLimits[i] = 1.0;
+		xyzLimits[i+1] = -1.0;
+	}
+}
+
+void ParallelCoordsMV::handleCommand(unsigned char key, double ldsX, double ldsY)
+{
+	if (key == 'd')
+	{
+		densityEnabled = !densityEnabled;
+		std::cout << "Parallel coordinates: density rendering "
+		          << (densityEnabled ? "on\n" : "off\n");
+	}
+	else
+		ModelView::handleCommand(key, ldsX, ldsY);
+}
+
+void ParallelCoordsMV::handleCommand(unsigned char key, int num, double ldsX, double ldsY)
+{
+	if (key == 'a')
+	{
+		if ((num >= 0) && (num+1 < static_cast<int>(axisOrder.size())))
+		{
+			swapAxes(num, num+1);
+			printAxisOrder();
+		}
+	}
+	else
+		ModelView::handleCommand(key, num, ldsX, ldsY);
+}
+
+void ParallelCoordsMV::printAxisOrder() const
+{
+	std::cout << "Parallel coordinates axes:";
+	for (int i=0 ; i<static_cast<int>(axisOrder.size()) ; i++)
+		std::cout << ' ' << i << ':' << vars[axisOrder[i]].name;
+	std::cout << '\n';
+}
+
+void ParallelCoordsMV::printKeyboardKeyList(bool firstCall) const
+{
+	ModelView::printKeyboardKeyList(firstCall);
+
+	std::cout << "ParallelCoordsMV:\n";
+	std::cout << "\td - toggle density rendering\n";
+	std::cout << "\ta@i -OR- a#ii$ - swap axes i and i+1 (0-based, left to right)\n";
+}
+
+void ParallelCoordsMV::render()
+{
+	int nAxes = axisOrder.size();
+	if ((nRows <= 0) || (nAxes == 0))
+		return;
+
+	// save the current GLSL program in use
+	GLint pgm;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &pgm);
+	glUseProgram(shaderProgram);
+
+	// reordering the axes only rewrites this table
+	if (axisOrderChanged)
+	{
+		glBindBuffer(GL_TEXTURE_BUFFER, axisBuffer);
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, nAxes*sizeof(GLint), &axisOrder[0]);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+		axisOrderChanged = false;
+	}
+
+	glBindVertexArray(vao[0]);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_BUFFER, valueTexture);
+	glUniform1i(ppuLoc_values, 0);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_BUFFER, axisTexture);
+	glUniform1i(ppuLoc_axisVariable, 1);
+	glActiveTexture(GL_TEXTURE0);
+	glUniform1i(ppuLoc_nVariables, nVariables);
+	glUniform1i(ppuLoc_nAxes, nAxes);
+	glUniform4fv(ppuLoc_ldsBounds, 1, LDS_BOUNDS);
+
+	// This is a 2D overlay: it is neither hidden by nor hides the 3D models.
+	GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+
+	if (densityEnabled)
+		renderDensity();
+	else
+	{
+		float color[4] = { 0.0, 0.0, 0.6, lineAlpha };
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		drawLines(color);
+	}
+
+	// the axes themselves, in black, on top:
+	glUseProgram(shaderProgram);
+	glBindVertexArray(vao[0]);
+	glUniform4f(ppuLoc_color, 0.0, 0.0, 0.0, 1.0);
+	glUniform1i(ppuLoc_drawAxes, 1);
+	glDrawArrays(GL_LINES, 0, 2*nAxes);
+
+	glDisable(GL_BLEND);
+	if (depthTest)
+		glEnable(GL_DEPTH_TEST);
+
+	// restore the previous program
+	glUseProgram(pgm);
+}
+
+// Counts the polylines through each pixel into densityTexture, then color
+// maps the counts onto the current framebuffer.
+void ParallelCoordsMV::renderDensity()
+{
+	GLint vp[4];
+	glGetIntegerv(GL_VIEWPORT, vp);
+	if ((vp[2] <= 0) || (vp[3] <= 0))
+		return;
+	GLint prevFBO;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFBO);
+	if ((densityFBO == 0) || (densityWidth != vp[2]) || (densityHeight != vp[3]))
+		defineDensityFBO(vp[2], vp[3]);
+	else
+		glBindFramebuffer(GL_FRAMEBUFFER, densityFBO);
+
+	// the FBO covers just the viewport
+	glViewport(0, 0, vp[2], vp[3]);
+	GLfloat zero[4] = { 0.0, 0.0, 0.0, 0.0 };
+	glClearBufferfv(GL_COLOR, 0, zero);
+	float one[4] = { 1.0, 0.0, 0.0, 0.0 };
+	glBlendFunc(GL_ONE, GL_ONE);
+	drawLines(one);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, prevFBO);
+	glViewport(vp[0], vp[1], vp[2], vp[3]);
+
+	glDisable(GL_BLEND);
+	glUseProgram(densityShaderProgram);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, densityTexture);
+	glUniform1i(ppuLoc_density, 0);
+	glUniform1i(ppuLoc_nRows, nRows);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+bool ParallelCoordsMV::setAxisOrder(const std::vector<int>& order)
+{
+	if (order.empty() || (order.size() > static_cast<size_t>(nVariables)))
+		return false;
+	for (std::vector<int>::const_iterator it=order.begin() ; it<order.end() ; it++)
+		if ((*it < 0) || (*it >= nVariables))
+			return false;
+	axisOrder = order;
+	axisOrderChanged = true;
+	return true;
+}
+
+void ParallelCoordsMV::swapAxes(int i, int j)
+{
+	int t = axisOrder[i];
+	axisOrder[i] = axisOrder[j];
+	axisOrder[j] = t;
+	axisOrderChanged = true;
+}
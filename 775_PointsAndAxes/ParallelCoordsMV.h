@@ -0,0 +1,85 @@
+// ParallelCoordsMV.h -- Every row of a DataSet drawn as a polyline across one
+//                       vertical axis per variable (in normalized units).
+//                       The normalized values are uploaded once as a buffer
+//                       texture; each row is one instance of a single shared
+//                       index buffer, so reordering the axes only rewrites
+//                       the small axis-to-variable table. For many rows the
+//                       polylines can instead be accumulated into a density
+//                       image that is then color mapped.
+//
+//                       The view is drawn directly in LDS (it ignores the 3D
+//                       viewing transformations) and contributes nothing to
+//                       the overall MC bounding box.
+
+#ifndef PARALLELCOORDSMV_H
+#define PARALLELCOORDSMV_H
+
+class DataSet;
+class ShaderIF;
+
+#include <vector>
+#include <GL/gl.h>
+
+#include "ModelView.h"
+#include "Variable.h"
+
+class ParallelCoordsMV : public ModelView
+{
+public:
+	ParallelCoordsMV(const DataSet& data);
+	virtual ~ParallelCoordsMV();
+
+	// xyzLimits: {mcXmin, mcXmax, mcYmin, mcYmax, mcZmin, mcZmax}
+	void getMCBoundingBox(double* xyzLimitsF) const;
+	void handleCommand(unsigned char key, double ldsX, double ldsY);
+	void handleCommand(unsigned char key, int num, double ldsX, double ldsY);
+	void printKeyboardKeyList(bool firstCall) const;
+	void render();
+
+	// "order" holds the (0-based) variable to show on each axis, left to
+	// right; variables may be omitted. Returns false if it is not valid.
+	bool setAxisOrder(const std::vector<int>& order);
+	const std::vector<int>& getAxisOrder() const { return axisOrder; }
+	void swapAxes(int i, int j);
+
+	void setDensityEnabled(bool b) { densityEnabled = b; }
+	bool getDensityEnabled() const { return densityEnabled; }
+
+	// rows above which density rendering is initially enabled
+	static const int DENSITY_THRESHOLD = 5000;
+
+private:
+	// structures to convey geometry to OpenGL/GLSL:
+	GLuint vao[1];
+	GLuint indexBuffer; // 0, 1, ..., nVariables-1; shared by all rows
+	GLuint valueBuffer, valueTexture; // normalized values; nVariables per row
+	GLuint axisBuffer, axisTexture; // variable shown on each axis
+
+	int nRows, nVariables;
+	const Variable* vars;
+	std::vector<int> axisOrder;
+	bool axisOrderChanged;
+	float lineAlpha;
+	bool densityEnabled;
+
+	// Offscreen GL_R32F target the polylines are counted into:
+	GLuint densityFBO, densityTexture;
+	int densityWidth, densityHeight;
+
+	static ShaderIF* shaderIF;
+	static ShaderIF* densityShaderIF;
+	static int numInstances;
+	static GLuint shaderProgram, densityShaderProgram;
+	static GLint ppuLoc_color, ppuLoc_values, ppuLoc_axisVariable;
+	static GLint ppuLoc_nVariables, ppuLoc_nAxes, ppuLoc_drawAxes, ppuLoc_ldsBounds;
+	static GLint ppuLoc_density, ppuLoc_nRows;
+
+	void defineDensityFBO(int width, int height);
+	void defineModel(const DataSet& data);
+	void drawLines(const float* color);
+	void printAxisOrder() const;
+	void renderDensity();
+	static void fetchGLSLVariableLocations();
+};
+
+#endif
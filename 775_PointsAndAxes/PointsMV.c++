@@ -1,7 +1,13 @@
 // PointsMV.c++
 
+#include <cmath>
 #include <iostream>
+#include <string.h>
+
 #include "PointsMV.h"
+#include "IconAtlas.h"
+#include "KDTree.h"
+#include "Selection.h"
 #include "ShaderIF.h"
 
 typedef float vec3[3];
@@ -9,24 +15,50 @@ GLuint* vbo;
 
 ShaderIF* PointsMV::shaderIF = NULL;
 int PointsMV::numInstances = 0;
+unsigned long PointsMV::shadersVersion = 1;
 GLuint PointsMV::shaderProgram = 0;
 GLint PointsMV::pvaLoc_mcPosition = -1;
 GLint PointsMV::pvaLoc_pvaSet1 = -1;
 GLint PointsMV::pvaLoc_pvaSet2 = -1;
-GLint PointsMV::ppuLoc_color = -1;
-GLint PointsMV::ppuLoc_mc_ec = -1;
-GLint PointsMV::ppuLoc_ec_lds = -1;
-GLint PointsMV::ppuLoc_xFactor = -1;
-GLint PointsMV::ppuLoc_yFactor = -1;
-GLint PointsMV::ppuLoc_sizeFactor = -1;
-GLint PointsMV::ppuLoc_attrToCutForCross = -1;
-GLint PointsMV::ppuLoc_attrToCutForHourglass = -1;
-GLint PointsMV::ppuLoc_attrToCutForCircle = -1;
-GLint PointsMV::ppuLoc_attrToUseForShape = -1;
-GLint PointsMV::ppuLoc_attrToUseForSize = -1;
-GLint PointsMV::ppuLoc_attrToUseForColor = -1;
-GLint PointsMV::ppuLoc_attrToCutForRed = -1;
-GLint PointsMV::ppuLoc_attrToCutForGreen = -1;
+GLint PointsMV::pvaLoc_mcPreviousPosition = -1;
+ShaderIF* PointsMV::glyphShaderIF = NULL;
+GLuint PointsMV::glyphShaderProgram = 0;
+ShaderIF* PointsMV::iconShaderIF = NULL;
+GLuint PointsMV::iconShaderProgram = 0;
+
+// Half-width, in pixels, of the scissored region around the cursor that
+// the ID pass draws into when picking.
+static const int PICK_RADIUS = 4;
+
+// If an update of the selection mask touches more separate word ranges
+// than this, the whole span from the first to the last is uploaded at once.
+static const int MAX_SELECTION_UPLOADS = 64;
+
+// uniform buffer binding points (after ModelView::VIEW_BLOCK_BINDING)
+static const GLuint GLYPH_TEMPLATE_BINDING = 1; // PointsGlyph.vsh's GlyphTemplate
+static const GLuint PARAMETER_BLOCK_BINDING = 2; // PointsParameters
+
+// std140 layout of the GlyphTemplate uniform block
+struct GlyphTemplate
+{
+	float vertex[PointsMV::MAX_GLYPH_VERTICES][4]; // base x, y; direction x, y
+	GLint attribute[PointsMV::MAX_GLYPH_VERTICES]; // -1 ==> none
+};
+
+// std140 layout of the PointsParameters uniform block (see PointsMV.vsh)
+struct PointsMV::ParameterBlock
+{
+	float color[4];
+	float sizeFactor;
+	float transition;
+	float attrToCutForCross, attrToCutForCircle, attrToCutForHourglass;
+	float attrToCutForRed, attrToCutForGreen;
+	GLint attrToUseForShape, attrToUseForSize, attrToUseForColor;
+	GLint haveSelection;
+	GLint nIcons, gridSide;
+	GLint pad[3]; // (the arrays start on a vec4 boundary)
+	float attrMin[MAX_ATTRIBUTES], attrMax[MAX_ATTRIBUTES];
+};
 
 static ShaderIF::ShaderSpec glslProg[] =
 	{
@@ -35,15 +67,36 @@ static ShaderIF::ShaderSpec glslProg[] =
 		{ "PointsMV.fsh", GL_FRAGMENT_SHADER }
 	};
 
-PointsMV::PointsMV(const cryph::AffPoint* pts, float* sps, float* sz, float* crs, int nPointsIn, GLenum modeIn) :
-	nPoints(nPointsIn), mode(modeIn)
+// The attribute each shader stage reads from, as a PVA component
+static std::string pvaComponent(int attribute)
+{
+	std::string component = (attribute < 4) ? "pvaSet1." : "pvaSet2.";
+	return component + "xyzw"[attribute % 4];
+}
+
+PointsMV::PointsMV(const cryph::Point3f* pts, float* sps, float* sz, float* crs, int nPointsIn, GLenum modeIn) :
+	nPoints(nPointsIn), mode(modeIn), mcPoints(NULL), mcPrevious(NULL),
+	transition(1.0), inTransition(false), attributes(NULL), nAttributes(3),
+	useForShape(0), useForSize(1), useForColor(2),
+	pointsProgram(0), glyphProgram(0), programsVersion(0),
+	glyphType(SHAPE_GLYPHS), nTemplateVertices(0), icons(NULL), ldsTree(NULL), ldsTreeVersion(0),
+	hoveredPoint(-1), selection(NULL), originalVars(NULL), nOriginalVars(0),
+	pickFBO(0), pickFBOWidth(0), pickFBOHeight(0)
 {
 	if (PointsMV::shaderProgram == 0)
 	{
-		// create the shader program:
+		// create the shader programs:
 		PointsMV::shaderIF = new ShaderIF(glslProg, 3);
 		PointsMV::shaderProgram = shaderIF->getShaderPgmID();
+		PointsMV::glyphShaderIF = new ShaderIF("PointsGlyph.vsh", "PointsMV.fsh");
+		PointsMV::glyphShaderProgram = glyphShaderIF->getShaderPgmID();
+		PointsMV::iconShaderIF = new ShaderIF("PointsIcon.vsh", "PointsIcon.fsh");
+		PointsMV::iconShaderProgram = iconShaderIF->getShaderPgmID();
 		fetchGLSLVariableLocations();
+		// (only acted on if ShaderIF::pollForChanges is being called)
+		shaderIF->setReloadCallback(shadersReloaded);
+		glyphShaderIF->setReloadCallback(shadersReloaded);
+		iconShaderIF->setReloadCallback(shadersReloaded);
 	}
 
 	// Now do instance-specific initialization:
@@ -54,69 +107,67 @@ PointsMV::PointsMV(const cryph::AffPoint* pts, float* sps, float* sz, float* crs
 PointsMV::~PointsMV()
 {
 	glDeleteBuffers(3, vertexBuffer);
-	glDeleteVertexArrays(1, vao);
+	glDeleteBuffers(1, &previousPositionBuffer);
+	glDeleteBuffers(1, &glyphTemplateBuffer);
+	glDeleteBuffers(1, &parameterBuffer);
+	glDeleteVertexArrays(2, vao);
+	glDeleteTextures(1, &selectionTexture);
+	glDeleteBuffers(1, &selectionBuffer);
+	if (pickFBO > 0)
+	{
+		glDeleteFramebuffers(1, &pickFBO);
+		glDeleteRenderbuffers(2, pickRenderBuffers);
+	}
 	if (--PointsMV::numInstances == 0)
 	{
 		PointsMV::shaderIF->destroy();
 		delete PointsMV::shaderIF;
 		PointsMV::shaderIF = NULL;
 		PointsMV::shaderProgram = 0;
+		PointsMV::glyphShaderIF->destroy();
+		delete PointsMV::glyphShaderIF;
+		PointsMV::glyphShaderIF = NULL;
+		PointsMV::glyphShaderProgram = 0;
+		PointsMV::iconShaderIF->destroy();
+		delete PointsMV::iconShaderIF;
+		PointsMV::iconShaderIF = NULL;
+		PointsMV::iconShaderProgram = 0;
 	}
 	delete [] vbo;
+	delete [] mcPoints;
+	delete [] mcPrevious;
+	delete [] attributes;
+	delete icons;
+	delete ldsTree;
+	delete selection;
+	delete parameters;
 }
 
-void PointsMV::defineModel(const cryph::AffPoint* pts, float* sps, float* sz, float* crs)
+void PointsMV::defineModel(const cryph::Point3f* pts, float* sps, float* sz, float* crs)
 {
 	typedef float vec3[3];
 	typedef float vec4[4];
 
-	float* points = new float[3*nPoints];
-	vec4* pvaSet = new vec4[nPoints];
+	mcPoints = new float[3*nPoints]; // retained for spatial queries
+	mcPrevious = new float[3*nPoints];
+	attributes = new float[MAX_ATTRIBUTES*nPoints];
+	for (int i=0 ; i<MAX_ATTRIBUTES*nPoints ; i++)
+		attributes[i] = 0.0;
 	vbo = new GLuint[2]; // one for coords, one for pvaSet1
-	
-	for (int i=0 ; i<nPoints ; i++)
-	{
-		pts[i].aCoords(points, 3*i);
-		if (i == 0)
-		{
-			minMax[0] = minMax[1] = pts[0].x;
-			minMax[2] = minMax[3] = pts[0].y;
-			minMax[4] = minMax[5] = pts[0].z;
-		}
-		else
-		{
-			if (pts[i].x < minMax[0])
-				minMax[0] = pts[i].x;
-			else if (pts[i].x > minMax[1])
-				minMax[1] = pts[i].x;
-			if (pts[i].y < minMax[2])
-				minMax[2] = pts[i].y;
-			else if (pts[i].y > minMax[3])
-				minMax[3] = pts[i].y;
-			if (pts[i].z < minMax[4])
-				minMax[4] = pts[i].z;
-			else if (pts[i].z > minMax[5])
-				minMax[5] = pts[i].z;
-		}
-		pvaSet[i][0] = sps[i];//shape
-		pvaSet[i][1] = sz[i];//size
-		pvaSet[i][2] = crs[i];//color
-
-	}
 
-	// send vertex data to GPU:
-	glGenVertexArrays(1, vao);
+	// allocate vertex data on GPU; updatePoints fills it:
+	glGenVertexArrays(2, vao);
 	glBindVertexArray(vao[0]);
 
 	glGenBuffers(3, vertexBuffer);
 
 	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer[0]);
-	glBufferData(GL_ARRAY_BUFFER, nPoints*sizeof(vec3), points, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, nPoints*sizeof(vec3), NULL, GL_STATIC_DRAW);
 	glVertexAttribPointer(pvaLoc_mcPosition, 3, GL_FLOAT, GL_FALSE, 0, 0);
 	glEnableVertexAttribArray(PointsMV::pvaLoc_mcPosition);
 
 	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer[1]);
-	glBufferData(GL_ARRAY_BUFFER, nPoints*sizeof(vec4), pvaSet, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, nPoints*sizeof(vec4), NULL, GL_STATIC_DRAW);
 	glVertexAttribPointer(pvaLoc_pvaSet1, 4, GL_FLOAT, GL_FALSE, 0, 0);
 	glEnableVertexAttribArray(PointsMV::pvaLoc_pvaSet1);
 
@@ -125,39 +176,201 @@ void PointsMV::defineModel(const cryph::AffPoint* pts, float* sps, float* sz, fl
 	glVertexAttribPointer(pvaLoc_pvaSet2, 4, GL_FLOAT, GL_FALSE, 0, 0);
 	glEnableVertexAttribArray(PointsMV::pvaLoc_pvaSet2);
 
-	delete [] pvaSet;
-	delete [] points;
+	glGenBuffers(1, &previousPositionBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, previousPositionBuffer);
+	glBufferData(GL_ARRAY_BUFFER, nPoints*sizeof(vec3), NULL, GL_STATIC_DRAW);
+	glVertexAttribPointer(pvaLoc_mcPreviousPosition, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	glEnableVertexAttribArray(PointsMV::pvaLoc_mcPreviousPosition);
+
+	// The same buffers, advancing once per glyph instance rather than once
+	// per vertex. (PointsGlyph.vsh uses the same attribute locations.)
+	glBindVertexArray(vao[1]);
+	GLint locs[4] = { pvaLoc_mcPosition, pvaLoc_pvaSet1, pvaLoc_pvaSet2, pvaLoc_mcPreviousPosition };
+	GLuint buffers[4] = { vertexBuffer[0], vertexBuffer[1], vertexBuffer[2], previousPositionBuffer };
+	for (int b=0 ; b<4 ; b++)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, buffers[b]);
+		glVertexAttribPointer(locs[b], ((b == 0) || (b == 3)) ? 3 : 4, GL_FLOAT, GL_FALSE, 0, 0);
+		glEnableVertexAttribArray(locs[b]);
+		glVertexAttribDivisor(locs[b], 1);
+	}
+	glBindVertexArray(vao[0]);
+
+	glGenBuffers(1, &glyphTemplateBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, glyphTemplateBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(GlyphTemplate), NULL, GL_STATIC_DRAW);
+	glGenBuffers(1, &parameterBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, parameterBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(ParameterBlock), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	parameters = new ParameterBlock;
+	memset(parameters, 0xff, sizeof(ParameterBlock)); // so the first update writes it
+
+	updatePoints(pts, sps, sz, crs);
+	// (no transition is in progress, but the shaders still read it)
+	memcpy(mcPrevious, mcPoints, 3*nPoints*sizeof(float));
+	glBindBuffer(GL_ARRAY_BUFFER, previousPositionBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, nPoints*sizeof(vec3), mcPrevious);
+
+	selection = new Selection(nPoints);
+	glGenBuffers(1, &selectionBuffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, selectionBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, selection->getNumWords()*sizeof(GLuint),
+		selection->getWords(), GL_DYNAMIC_DRAW);
+	glGenTextures(1, &selectionTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, selectionTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, selectionBuffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	selection->clearChanges();
+}
+
+void PointsMV::animate(double t)
+{
+	if (!inTransition)
+		return;
+	transition = t;
+	if (t >= 1.0)
+		inTransition = false;
+}
+
+void PointsMV::beginTransition()
+{
+	// start from wherever the points are drawn now
+	if (transition >= 1.0)
+		memcpy(mcPrevious, mcPoints, 3*nPoints*sizeof(float));
+	else
+		for (int i=0 ; i<3*nPoints ; i++)
+			mcPrevious[i] += transition * (mcPoints[i] - mcPrevious[i]);
+	glBindBuffer(GL_ARRAY_BUFFER, previousPositionBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, 3*nPoints*sizeof(float), mcPrevious);
+	transition = 0.0;
+	inTransition = true;
+}
+
+// Builds the triangles of a glyph whose rays (or bars) have the lengths
+// of attributes 0..nAttributes-1. Only needs to be redone when the type
+// of glyph or the number of attributes changes.
+void PointsMV::defineGlyphTemplate()
+{
+	GlyphTemplate t;
+	int n = 0;
+	if (glyphType == STAR_GLYPHS)
+	{
+		// triangles from the center to the tips of successive rays; the
+		// first ray points up
+		const double PI = 3.14159265358979;
+		for (int k=0 ; k<nAttributes ; k++)
+		{
+			int k1 = (k + 1) % nAttributes;
+			double theta = 0.5*PI + 2.0*PI*k/nAttributes;
+			double theta1 = 0.5*PI + 2.0*PI*k1/nAttributes;
+			float v[3][4] = { { 0.0, 0.0, 0.0, 0.0 },
+				{ 0.0, 0.0, static_cast<float>(cos(theta)), static_cast<float>(sin(theta)) },
+				{ 0.0, 0.0, static_cast<float>(cos(theta1)), static_cast<float>(sin(theta1)) } };
+			int a[3] = { -1, k, k1 };
+			for (int j=0 ; j<3 ; j++, n++)
+			{
+				memcpy(t.vertex[n], v[j], sizeof(v[j]));
+				t.attribute[n] = a[j];
+			}
+		}
+	}
+	else if (glyphType == PROFILE_GLYPHS)
+	{
+		// the area under the polyline through the tops of the bars, which
+		// stand on y = -0.5 between x = -1 and x = 1
+		for (int k=0 ; k+1<nAttributes ; k++)
+		{
+			float x0 = -1.0 + 2.0*k/(nAttributes-1), x1 = -1.0 + 2.0*(k+1)/(nAttributes-1);
+			float v[6][4] = { { x0, -0.5, 0.0, 0.0 }, { x1, -0.5, 0.0, 0.0 }, { x0, -0.5, 0.0, 1.0 },
+				{ x0, -0.5, 0.0, 1.0 }, { x1, -0.5, 0.0, 0.0 }, { x1, -0.5, 0.0, 1.0 } };
+			int a[6] = { -1, -1, k, k, -1, k+1 };
+			for (int j=0 ; j<6 ; j++, n++)
+			{
+				memcpy(t.vertex[n], v[j], sizeof(v[j]));
+				t.attribute[n] = a[j];
+			}
+		}
+	}
+	nTemplateVertices = n;
+	glBindBuffer(GL_UNIFORM_BUFFER, glyphTemplateBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(GlyphTemplate), &t);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void PointsMV::definePickFBO(int width, int height)
+{
+	if (pickFBO == 0)
+	{
+		glGenFramebuffers(1, &pickFBO);
+		glGenRenderbuffers(2, pickRenderBuffers);
+	}
+	glBindRenderbuffer(GL_RENDERBUFFER, pickRenderBuffers[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_R32UI, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, pickRenderBuffers[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, pickFBO);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+		GL_RENDERBUFFER, pickRenderBuffers[0]);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+		GL_RENDERBUFFER, pickRenderBuffers[1]);
+	// PointsMV.fsh writes point IDs to output location 1; color output 0
+	// is discarded in this framebuffer.
+	GLenum drawBuffers[2] = { GL_NONE, GL_COLOR_ATTACHMENT0 };
+	glDrawBuffers(2, drawBuffers);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cerr << "PointsMV::definePickFBO: incomplete framebuffer\n";
+
+	pickFBOWidth = width;
+	pickFBOHeight = height;
 }
 
 void PointsMV::fetchGLSLVariableLocations()
 {
+	// Everything else the programs read comes from uniform blocks (see
+	// render) or from these texture units.
 	if (PointsMV::shaderProgram > 0)
 	{
-		pvaLoc_mcPosition = pvAttribLocation(shaderProgram, "mcPosition");
-		pvaLoc_pvaSet1 = pvAttribLocation(shaderProgram, "pvaSet1");
-		pvaLoc_pvaSet2 = pvAttribLocation(shaderProgram, "pvaSet2");
-		ppuLoc_color = ppUniformLocation(shaderProgram, "color");
-		ppuLoc_mc_ec = ppUniformLocation(shaderProgram, "mc_ec");
-		ppuLoc_ec_lds = ppUniformLocation(shaderProgram, "ec_lds");
-		ppuLoc_xFactor = ppUniformLocation(shaderProgram, "xFactor");
-		ppuLoc_yFactor = ppUniformLocation(shaderProgram, "yFactor");
-		ppuLoc_sizeFactor = ppUniformLocation(shaderProgram, "sizeFactor");
-		ppuLoc_attrToCutForCross = ppUniformLocation(shaderProgram, "attrToCutForCross");
-		ppuLoc_attrToCutForCircle = ppUniformLocation(shaderProgram, "attrToCutForCircle");		
-		ppuLoc_attrToCutForHourglass = ppUniformLocation(shaderProgram, "attrToCutForHourglass");	
-		ppuLoc_attrToUseForShape = ppUniformLocation(shaderProgram, "attrToUseForShape");
-		ppuLoc_attrToUseForSize = ppUniformLocation(shaderProgram, "attrToUseForSize");
-		ppuLoc_attrToUseForColor = ppUniformLocation(shaderProgram, "attrToUseForColor");	
-		ppuLoc_attrToCutForRed = ppUniformLocation(shaderProgram, "attrToCutForRed");
-		ppuLoc_attrToCutForGreen = ppUniformLocation(shaderProgram, "attrToCutForGreen");
+		// Attribute locations are fixed in PointsMV.vsh, so they are taken
+		// from the general program: a variant may not use all of them.
+		GLuint general = shaderIF->getShaderPgmID();
+		pvaLoc_mcPosition = pvAttribLocation(general, "mcPosition");
+		pvaLoc_pvaSet1 = pvAttribLocation(general, "pvaSet1");
+		pvaLoc_pvaSet2 = pvAttribLocation(general, "pvaSet2");
+		pvaLoc_mcPreviousPosition = pvAttribLocation(general, "mcPreviousPosition");
+		bindUniformBlock(shaderProgram, "ViewTransformation", VIEW_BLOCK_BINDING);
+		bindUniformBlock(shaderProgram, "PointsParameters", PARAMETER_BLOCK_BINDING);
+		glProgramUniform1i(shaderProgram, ppUniformLocation(shaderProgram, "selectionMask"), 0);
+	}
+	if (PointsMV::glyphShaderProgram > 0)
+	{
+		bindUniformBlock(glyphShaderProgram, "ViewTransformation", VIEW_BLOCK_BINDING);
+		bindUniformBlock(glyphShaderProgram, "PointsParameters", PARAMETER_BLOCK_BINDING);
+		bindUniformBlock(glyphShaderProgram, "GlyphTemplate", GLYPH_TEMPLATE_BINDING);
+		glProgramUniform1i(glyphShaderProgram,
+			ppUniformLocation(glyphShaderProgram, "selectionMask"), 0);
+	}
+	if (PointsMV::iconShaderProgram > 0)
+	{
+		bindUniformBlock(iconShaderProgram, "ViewTransformation", VIEW_BLOCK_BINDING);
+		bindUniformBlock(iconShaderProgram, "PointsParameters", PARAMETER_BLOCK_BINDING);
+		glProgramUniform1i(iconShaderProgram,
+			ppUniformLocation(iconShaderProgram, "selectionMask"), 0);
+		glProgramUniform1i(iconShaderProgram,
+			ppUniformLocation(iconShaderProgram, "iconAtlas"), 1);
 	}
 }
 
+// Attribute choices outside 0..MAX_ATTRIBUTES-1 revert to the defaults
 void PointsMV::normalAttributes()
 {
-	if(useForShape != 0) useForShape = 0;
-	if(useForSize != 1) useForSize = 1;
-	if(useForColor != 2) useForColor = 2;
+	if ((useForShape < 0) || (useForShape >= MAX_ATTRIBUTES)) useForShape = 0;
+	if ((useForSize < 0) || (useForSize >= MAX_ATTRIBUTES)) useForSize = 1;
+	if ((useForColor < 0) || (useForColor >= MAX_ATTRIBUTES)) useForColor = 2;
 }
 
 // xyzLimits: {mcXmin, mcXmax, mcYmin, mcYmax, mcZmin, mcZmax}
@@ -167,58 +380,477 @@ void PointsMV::getMCBoundingBox(double* xyzLimits) const
 		xyzLimits[i] = minMax[i];
 }
 
-void PointsMV::render()
+void PointsMV::handleCommand(unsigned char key, double ldsX, double ldsY)
+{
+	if (key == 'c')
+	{
+		selection->clear();
+		std::cout << "Selection cleared\n";
+	}
+	else if (key == 'g')
+	{
+		static const char* names[] = { "shape", "star", "profile", "icon" };
+		static const int nAttributesShown[] = { 2, -1, -1, 2 };
+		setGlyphType(static_cast<GlyphType>((glyphType + 1) % 4));
+		int n = (nAttributesShown[glyphType] < 0) ? nAttributes : nAttributesShown[glyphType];
+		std::cout << "Drawing " << names[glyphType] << " glyphs of " << n << " attributes\n";
+	}
+	else if (key == 'm')
+	{
+		std::cout << "Means over the " << selection->getNumSelected()
+		          << " selected points:\n";
+		if (selection->getNumSelected() > 0)
+		{
+			float* means = new float[nOriginalVars];
+			selection->getMeans(originalVars, nOriginalVars, means);
+			for (int v=0 ; v<nOriginalVars ; v++)
+				std::cout << '\t' << originalVars[v].name << " = " << means[v] << '\n';
+			delete [] means;
+		}
+	}
+	else
+		ModelView::handleCommand(key, ldsX, ldsY);
+}
+
+bool PointsMV::hovered(double ldsX, double ldsY)
 {
-	float xFactor(1.0), yFactor(1.0);
-	// save the current GLSL program in use
-	GLint pgm;
-	glGetIntegerv(GL_CURRENT_PROGRAM, &pgm);
-	// draw the triangles using our vertex and fragment shaders
-	glUseProgram(shaderProgram);
+	GLint vp[4];
+	glGetIntegerv(GL_VIEWPORT, vp);
+	int vpMin = (vp[2] < vp[3]) ? vp[2] : vp[3];
+	if (vpMin <= 0)
+		return false;
+	int which = nearestPoint(ldsX, ldsY, 2.0 * PICK_RADIUS / vpMin);
+	if ((which >= 0) && (which != hoveredPoint))
+		std::cout << "Hovering over data row " << (which + 1) << '\n';
+	hoveredPoint = which;
+	return which >= 0;
+}
 
-	// Retrieve and establish view mapping
-	cryph::Matrix4x4 mc_ec, ec_lds;
-	float buf[16];
-	ModelView::getMatrices(mc_ec, ec_lds);
-	glUniformMatrix4fv(ppuLoc_mc_ec, 1, false, mc_ec.extractColMajor(buf));
-	glUniformMatrix4fv(ppuLoc_ec_lds, 1, false, ec_lds.extractColMajor(buf));
+int PointsMV::kNearestPoints(double ldsX, double ldsY, int k, int* indices)
+{
+	updateLDSTree();
+	float q[2] = { static_cast<float>(ldsX), static_cast<float>(ldsY) };
+	return ldsTree->kNearest(q, k, indices);
+}
+
+int PointsMV::nearestPoint(double ldsX, double ldsY, double maxLDSDist)
+{
+	updateLDSTree();
+	float q[2] = { static_cast<float>(ldsX), static_cast<float>(ldsY) };
+	return ldsTree->nearest(q, maxLDSDist);
+}
+
+bool PointsMV::picked(double ldsX, double ldsY)
+{
+	int which = pickPoint(ldsX, ldsY);
+	if (which < 0)
+		return false;
+
+	std::cout << "Picked data row " << (which + 1) << ":\n";
+	for (int v=0 ; v<nOriginalVars ; v++)
+		std::cout << '\t' << originalVars[v].name << " = "
+		          << originalVars[v].getValue(which) << '\n';
+	return true;
+}
+
+// Renders point IDs into the scissored region of pickFBO around (ldsX, ldsY)
+// and returns the index of the point nearest the cursor, or -1 if none.
+int PointsMV::pickPoint(double ldsX, double ldsY)
+{
+	GLint vp[4];
+	glGetIntegerv(GL_VIEWPORT, vp);
+	if ((vp[2] <= 0) || (vp[3] <= 0))
+		return -1;
+	if ((pickFBO == 0) || (pickFBOWidth != vp[2]) || (pickFBOHeight != vp[3]))
+		definePickFBO(vp[2], vp[3]);
+
+	int px = static_cast<int>(0.5 * (ldsX + 1.0) * vp[2]);
+	int py = static_cast<int>(0.5 * (ldsY + 1.0) * vp[3]);
+	int x0 = px - PICK_RADIUS, y0 = py - PICK_RADIUS;
+	int x1 = px + PICK_RADIUS + 1, y1 = py + PICK_RADIUS + 1;
+	if (x0 < 0) x0 = 0;
+	if (y0 < 0) y0 = 0;
+	if (x1 > vp[2]) x1 = vp[2];
+	if (y1 > vp[3]) y1 = vp[3];
+	if ((x0 >= x1) || (y0 >= y1))
+		return -1;
+	int w = x1 - x0, h = y1 - y0;
+
+	GLint prevFBO;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, pickFBO);
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(x0, y0, w, h);
+
+	// ID 0 means "no point"; the fragment shader writes (point index + 1).
+	GLuint noPoint[4] = { 0, 0, 0, 0 };
+	glClearBufferuiv(GL_COLOR, 1, noPoint);
+	glClear(GL_DEPTH_BUFFER_BIT);
+	render();
+
+	GLuint* ids = new GLuint[w*h];
+	glReadPixels(x0, y0, w, h, GL_RED_INTEGER, GL_UNSIGNED_INT, ids);
+
+	glDisable(GL_SCISSOR_TEST);
+	glBindFramebuffer(GL_FRAMEBUFFER, prevFBO);
+
+	int which = -1, bestD2 = 0;
+	for (int row=0 ; row<h ; row++)
+		for (int col=0 ; col<w ; col++)
+		{
+			GLuint id = ids[row*w + col];
+			if ((id == 0) || (id > static_cast<GLuint>(nPoints)))
+				continue;
+			int dx = x0 + col - px, dy = y0 + row - py;
+			int d2 = dx*dx + dy*dy;
+			if ((which < 0) || (d2 < bestD2))
+			{
+				which = static_cast<int>(id) - 1;
+				bestD2 = d2;
+			}
+		}
+	delete [] ids;
+	return which;
+}
+
+void PointsMV::pointsInLasso(const double* ldsXY, int nVertices, std::vector<int>& result)
+{
+	updateLDSTree();
+	float* xy = new float[2*nVertices];
+	for (int i=0 ; i<2*nVertices ; i++)
+		xy[i] = static_cast<float>(ldsXY[i]);
+	ldsTree->inPolygon(xy, nVertices, result);
+	delete [] xy;
+}
+
+void PointsMV::pointsInRectangle(double ldsX0, double ldsY0, double ldsX1, double ldsY1,
+	std::vector<int>& result)
+{
+	updateLDSTree();
+	float lo[2] = { static_cast<float>(ldsX0), static_cast<float>(ldsY0) };
+	float hi[2] = { static_cast<float>(ldsX1), static_cast<float>(ldsY1) };
+	for (int i=0 ; i<2 ; i++)
+		if (lo[i] > hi[i])
+		{
+			float t = lo[i]; lo[i] = hi[i]; hi[i] = t;
+		}
+	ldsTree->inRectangle(lo, hi, result);
+}
+
+void PointsMV::printKeyboardKeyList(bool firstCall) const
+{
+	ModelView::printKeyboardKeyList(firstCall);
+
+	std::cout << "PointsMV:\n";
+	std::cout << "\tc - clear the selection\n";
+	std::cout << "\tm - print variable means over the selection\n";
+	std::cout << "\tg - cycle through shape, star, profile and (if given) icon glyphs\n";
+}
 
+void PointsMV::render()
+{
+	// The view was uploaded for the frame (ModelView::updateViewUniformBlock);
+	// this instance's parameters are rewritten only if they have changed.
+	if (programsVersion != shadersVersion)
+		selectProgramVariants();
+	updateParameterBlock();
+	updateSelectionBuffer();
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_BUFFER, selectionTexture);
+	if (glyphType == ICON_GLYPHS)
+	{
+		renderIcons();
+		return;
+	}
+	if (glyphType != SHAPE_GLYPHS)
+	{
+		renderGlyphs();
+		return;
+	}
+	glUseProgram(pointsProgram);
 	glBindVertexArray(vao[0]);
+	glPointSize(3.0); // just in case mode == GL_POINTS
+	glDrawArrays(mode, 0, nPoints);
+}
+
+// One instance of the glyph template per point
+void PointsMV::renderGlyphs()
+{
+	glUseProgram(glyphProgram);
+	glBindVertexArray(vao[1]);
+	glBindBufferBase(GL_UNIFORM_BUFFER, GLYPH_TEMPLATE_BINDING, glyphTemplateBuffer);
+	glDrawArraysInstanced(GL_TRIANGLES, 0, nTemplateVertices, nPoints);
+}
+
+// One instance of a textured quad per point; the icon is looked up in the
+// atlas by the shader, so the cost does not depend on the number of icons.
+void PointsMV::renderIcons()
+{
+	glUseProgram(iconShaderProgram);
+	glBindVertexArray(vao[1]);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, icons->getTexture());
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, nPoints);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+// Finds the programs specialized for the current attribute choices
+// (building them the first time they are used), and sets up their uniforms
+// if they were not the last ones set up. The general programs are the
+// fallback. Called only after the choices change or the shaders reload.
+void PointsMV::selectProgramVariants()
+{
+	std::vector<std::string> defines;
+	defines.push_back("SHAPE_ATTRIBUTE " + pvaComponent(useForShape));
+	defines.push_back("SIZE_ATTRIBUTE " + pvaComponent(useForSize));
+	defines.push_back("COLOR_ATTRIBUTE " + pvaComponent(useForColor));
+	GLuint pgm = shaderIF->getVariantPgmID(defines);
+	if (pgm == 0)
+		pgm = shaderIF->getShaderPgmID();
+	GLuint glyphPgm = glyphShaderIF->getVariantPgmID(
+		std::vector<std::string>(1, defines[2]));
+	if (glyphPgm == 0)
+		glyphPgm = glyphShaderIF->getShaderPgmID();
+	if ((pgm != shaderProgram) || (glyphPgm != glyphShaderProgram))
+	{
+		shaderProgram = pgm;
+		glyphShaderProgram = glyphPgm;
+		fetchGLSLVariableLocations();
+	}
+	pointsProgram = pgm;
+	glyphProgram = glyphPgm;
+	programsVersion = shadersVersion;
+}
+
+void PointsMV::selectRegion(const double* ldsXY, int nVertices)
+{
+	std::vector<int> inRegion;
+	if (nVertices == 2)
+		pointsInRectangle(ldsXY[0], ldsXY[1], ldsXY[2], ldsXY[3], inRegion);
+	else
+		pointsInLasso(ldsXY, nVertices, inRegion);
+	selection->select(inRegion, REPLACE_SELECTION);
+	std::cout << selection->getNumSelected() << " points selected\n";
+}
+
+void PointsMV::setAttributesToUse(int shape, int size, int color)
+{
+	useForShape = shape;
+	useForSize = size;
+	useForColor = color;
 	normalAttributes();
+	programsVersion = 0;
+}
 
-	glUniform4f(ppuLoc_color, 1.0, 0.0, 0.0, 1.0); // Red
+void PointsMV::setExtraAttributes(const float* values, int nValues)
+{
+	// nValues stays the stride of "values"; only the number used is limited
+	int nUsed = nValues;
+	if (nUsed > MAX_ATTRIBUTES - 3)
+		nUsed = MAX_ATTRIBUTES - 3;
+	else if (nUsed < 0)
+		nUsed = 0;
+	for (int i=0 ; i<nPoints ; i++)
+		for (int a=3 ; a<MAX_ATTRIBUTES ; a++)
+			attributes[MAX_ATTRIBUTES*i + a] = (a < 3+nUsed) ? values[nValues*i + a-3] : 0.0;
+	int wasNAttributes = nAttributes;
+	nAttributes = 3 + nUsed;
+	updateAttributes();
+	if (nAttributes != wasNAttributes)
+		defineGlyphTemplate();
+}
+
+void PointsMV::setGlyphType(GlyphType type)
+{
+	if ((type == ICON_GLYPHS) && (icons == NULL))
+		type = SHAPE_GLYPHS;
+	glyphType = type;
+	defineGlyphTemplate();
+}
 
-	// Aspect ratio considerations for geometry shader:
-	// (We need to talk about this in class - remind me if I forget!
-	
-	if (ModelView::aspectRatioPreservationEnabled)
+bool PointsMV::setIcons(const std::vector<std::string>& fileNames)
+{
+	IconAtlas* atlas = new IconAtlas();
+	if (!atlas->load(fileNames))
 	{
-		float ratio = ModelView::ecDeltaY / ModelView::ecDeltaX;
-		if (ratio > 1.0)
-			yFactor = 1.0 / ratio;
-		else
-			xFactor = ratio;
+		delete atlas;
+		return false;
+	}
+	delete icons;
+	icons = atlas;
+	return true;
+}
+
+void PointsMV::setOriginalData(const Variable* vars, int nVars)
+{
+	originalVars = vars;
+	nOriginalVars = nVars;
+}
+
+// Called by ShaderIF once edited shader sources have been rebuilt. The
+// variants were dropped; every instance selects (and so rebuilds) them
+// again at its next render.
+void PointsMV::shadersReloaded(ShaderIF* reloaded, void* context)
+{
+	shaderProgram = shaderIF->getShaderPgmID();
+	glyphShaderProgram = glyphShaderIF->getShaderPgmID();
+	iconShaderProgram = iconShaderIF->getShaderPgmID();
+	fetchGLSLVariableLocations();
+	shadersVersion++;
+}
+
+// Sends pvaSet1 and pvaSet2 of every point to the GPU and finds the
+// range of each attribute (which scales the glyphs).
+void PointsMV::updateAttributes()
+{
+	typedef float vec4[4];
+
+	vec4* pvaSet1 = new vec4[nPoints];
+	vec4* pvaSet2 = new vec4[nPoints];
+	for (int a=0 ; a<MAX_ATTRIBUTES ; a++)
+		attrMin[a] = attrMax[a] = attributes[a];
+	for (int i=0 ; i<nPoints ; i++)
+	{
+		const float* attr = &attributes[MAX_ATTRIBUTES*i];
+		memcpy(pvaSet1[i], attr, sizeof(vec4));
+		memcpy(pvaSet2[i], attr+4, sizeof(vec4));
+		for (int a=0 ; a<MAX_ATTRIBUTES ; a++)
+		{
+			if (attr[a] < attrMin[a])
+				attrMin[a] = attr[a];
+			else if (attr[a] > attrMax[a])
+				attrMax[a] = attr[a];
+		}
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer[1]);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, nPoints*sizeof(vec4), pvaSet1);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer[2]);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, nPoints*sizeof(vec4), pvaSet2);
+
+	delete [] pvaSet1;
+	delete [] pvaSet2;
+}
+
+// Rewrites parameterBuffer if any of the values it holds have changed
+// since it was last written (between frames, they usually have not).
+void PointsMV::updateParameterBlock()
+{
+	static_assert(sizeof(ParameterBlock) == 144, "PointsParameters is 144 bytes in std140");
+	ParameterBlock block;
+	memset(&block, 0, sizeof(block));
+	block.color[0] = 1.0; block.color[3] = 1.0; // Red
+	block.sizeFactor = sizeFactor;
+	block.transition = transition;
+	block.attrToCutForCross = cutForCross;
+	block.attrToCutForCircle = cutForCircle;
+	block.attrToCutForHourglass = cutForHourglass;
+	block.attrToCutForRed = cutForRed;
+	block.attrToCutForGreen = cutForGreen;
+	block.attrToUseForShape = useForShape;
+	block.attrToUseForSize = useForSize;
+	block.attrToUseForColor = useForColor;
+	block.haveSelection = (selection->getNumSelected() > 0) ? 1 : 0;
+	if (icons != NULL)
+	{
+		block.nIcons = icons->getNumIcons();
+		block.gridSide = icons->getGridSide();
+	}
+	memcpy(block.attrMin, attrMin, sizeof(attrMin));
+	memcpy(block.attrMax, attrMax, sizeof(attrMax));
+	if (memcmp(&block, parameters, sizeof(block)) != 0)
+	{
+		*parameters = block;
+		glBindBuffer(GL_UNIFORM_BUFFER, parameterBuffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &block);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
 	}
-	glUniform1f(ppuLoc_xFactor, xFactor);
-	glUniform1f(ppuLoc_yFactor, yFactor);
-	// END: Aspect ratio considerations for geometry shader
+	glBindBufferBase(GL_UNIFORM_BUFFER, PARAMETER_BLOCK_BINDING, parameterBuffer);
+}
 
-	glUniform1f(ppuLoc_sizeFactor, sizeFactor);
+void PointsMV::updatePoints(const cryph::Point3f* pts, float* sps, float* sz, float* crs)
+{
+	// Point3f arrays are packed xyz floats
+	memcpy(mcPoints, pts, nPoints*sizeof(cryph::Point3f));
+	for (int i=0 ; i<nPoints ; i++)
+	{
+		if (i == 0)
+		{
+			minMax[0] = minMax[1] = pts[0].x;
+			minMax[2] = minMax[3] = pts[0].y;
+			minMax[4] = minMax[5] = pts[0].z;
+		}
+		else
+		{
+			if (pts[i].x < minMax[0])
+				minMax[0] = pts[i].x;
+			else if (pts[i].x > minMax[1])
+				minMax[1] = pts[i].x;
+			if (pts[i].y < minMax[2])
+				minMax[2] = pts[i].y;
+			else if (pts[i].y > minMax[3])
+				minMax[3] = pts[i].y;
+			if (pts[i].z < minMax[4])
+				minMax[4] = pts[i].z;
+			else if (pts[i].z > minMax[5])
+				minMax[5] = pts[i].z;
+		}
+		attributes[MAX_ATTRIBUTES*i + 0] = sps[i];//shape
+		attributes[MAX_ATTRIBUTES*i + 1] = sz[i];//size
+		attributes[MAX_ATTRIBUTES*i + 2] = crs[i];//color
+	}
 
-	glUniform1f(ppuLoc_attrToCutForCross, cutForCross);
-	glUniform1f(ppuLoc_attrToCutForCircle, cutForCircle);
-	glUniform1f(ppuLoc_attrToCutForHourglass, cutForHourglass);
+	// send vertex data to GPU:
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer[0]);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, nPoints*sizeof(cryph::Point3f), pts);
+	updateAttributes();
 
-	glUniform1i(ppuLoc_attrToUseForShape, useForShape);
-	glUniform1i(ppuLoc_attrToUseForSize, useForSize);
-	glUniform1i(ppuLoc_attrToUseForColor, useForColor);
+	// the LDS positions of the points have changed
+	delete ldsTree;
+	ldsTree = NULL;
+	hoveredPoint = -1;
+}
 
-	glUniform1f(ppuLoc_attrToCutForRed, cutForRed);
-	glUniform1f(ppuLoc_attrToCutForGreen, cutForGreen);
+// Copies the words of the selection mask changed since the last update
+// to the GPU.
+void PointsMV::updateSelectionBuffer()
+{
+	std::vector<std::pair<int,int> > ranges;
+	selection->getChangedWordRanges(ranges);
+	if (ranges.empty())
+		return;
+	if (ranges.size() > MAX_SELECTION_UPLOADS)
+	{
+		ranges.front().second = ranges.back().second;
+		ranges.resize(1);
+	}
+	const GLuint* words = selection->getWords();
+	glBindBuffer(GL_TEXTURE_BUFFER, selectionBuffer);
+	for (std::vector<std::pair<int,int> >::iterator it=ranges.begin() ; it<ranges.end() ; it++)
+		glBufferSubData(GL_TEXTURE_BUFFER, it->first*sizeof(GLuint),
+			(it->second - it->first + 1)*sizeof(GLuint), &words[it->first]);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	selection->clearChanges();
+}
 
-	glPointSize(3.0); // just in case mode == GL_POINTS
-	glDrawArrays(mode, 0, nPoints);
+void PointsMV::updateLDSTree()
+{
+	const ModelView::ViewState& view = ModelView::getViewState();
+	if ((ldsTree != NULL) && (ldsTreeVersion == view.version))
+		return;
+	ldsTreeVersion = view.version;
 
-	// restore the previous program
-	glUseProgram(pgm);
+	cryph::Matrix4x4 mc_ec, ec_lds;
+	ModelView::getMatrices(mc_ec, ec_lds);
+	float* ldsPoints = new float[3*nPoints];
+	(ec_lds * mc_ec).transformPoints(mcPoints, nPoints, ldsPoints, true);
+	// keep just (x, y), packed
+	for (int i=0 ; i<nPoints ; i++)
+	{
+		ldsPoints[2*i] = ldsPoints[3*i];
+		ldsPoints[2*i+1] = ldsPoints[3*i+1];
+	}
+	if (ldsTree == NULL)
+		ldsTree = new KDTree(2);
+	ldsTree->build(ldsPoints, nPoints);
+	delete [] ldsPoints;
 }
@@ -3,48 +3,171 @@
 #ifndef POINTSMV_H
 #define POINTSMV_H
 
+class KDTree;
+class Selection;
+class IconAtlas;
 class ShaderIF;
 
+#include <string>
+#include <vector>
 #include <GL/gl.h>
 
 #include "ModelView.h"
+#include "Point3.h"
+#include "Variable.h"
+
+// SHAPE_GLYPHS: a cross, circle, hourglass or star chosen by one attribute
+// STAR_GLYPHS: one ray per attribute; PROFILE_GLYPHS: one bar per attribute
+// ICON_GLYPHS: an image (see PointsMV::setIcons) chosen like SHAPE_GLYPHS
+enum GlyphType
+{
+	SHAPE_GLYPHS, STAR_GLYPHS, PROFILE_GLYPHS, ICON_GLYPHS
+};
 
 class PointsMV : public ModelView
 {
 public:
-	PointsMV(const cryph::AffPoint* pts, float* sps, float* sz, float* crs, int nPointsIn, GLenum modeIn);
+	PointsMV(const cryph::Point3f* pts, float* sps, float* sz, float* crs, int nPointsIn, GLenum modeIn);
 	virtual ~PointsMV();
 
 	// xyzLimits: {mcXmin, mcXmax, mcYmin, mcYmax, mcZmin, mcZmax}
 	void getMCBoundingBox(double* xyzLimitsF) const;
+	void handleCommand(unsigned char key, double ldsX, double ldsY);
+	bool hovered(double ldsX, double ldsY);
+	bool picked(double ldsX, double ldsY);
+	void printKeyboardKeyList(bool firstCall) const;
 	void render();
+	void selectRegion(const double* ldsXY, int nVertices);
+
+	// Points not in the selection are drawn dimmed. An empty selection
+	// means all points are drawn normally.
+	Selection* getSelection() { return selection; }
+
+	// Queries in LDS over the points as currently viewed. The returned
+	// values are point indices (i.e., OKC data rows). nearestPoint returns
+	// -1 if no point is within maxLDSDist (maxLDSDist < 0 => no limit).
+	int nearestPoint(double ldsX, double ldsY, double maxLDSDist=-1.0);
+	int kNearestPoints(double ldsX, double ldsY, int k, int* indices);
+	void pointsInRectangle(double ldsX0, double ldsY0, double ldsX1, double ldsY1,
+		std::vector<int>& result);
+	void pointsInLasso(const double* ldsXY, int nVertices, std::vector<int>& result);
+
+	// Replace the positions and attributes 0-2 of all nPoints points
+	void updatePoints(const cryph::Point3f* pts, float* sps, float* sz, float* crs);
+	// "values" holds nValues per point. Attributes 3.. are replaced with
+	// the first (at most 5) of them; any remaining attributes are 0.
+	void setExtraAttributes(const float* values, int nValues);
+	// The next updatePoints morphs the points from where they are
+	// currently drawn as animate() goes from 0 to 1, instead of moving
+	// them at once. Only the positions are interpolated (on the GPU).
+	void beginTransition();
+	void animate(double t);
+
+	// Star and profile glyphs use all the attributes that have been set.
+	// Icon glyphs are only available once icons have been set.
+	void setGlyphType(GlyphType type);
+	// Shape category k (see cutForCross, etc.) is drawn with icon
+	// k % fileNames.size(). Returns false if the images cannot be read.
+	bool setIcons(const std::vector<std::string>& fileNames);
+	GlyphType getGlyphType() const { return glyphType; }
+
+	// The OKC variables the points were derived from. Point i is assumed
+	// to come from row i of each variable. Used only to report picks.
+	void setOriginalData(const Variable* vars, int nVars);
 
 	float sizeFactor;
 	float cutForCross, cutForCircle, cutForHourglass;
 	float cutForRed, cutForGreen;
-	int useForShape, useForSize, useForColor;
+	// Attributes 0-3 are pvaSet1; 4-7 are pvaSet2. Choices outside
+	// 0..MAX_ATTRIBUTES-1 revert to the defaults (0, 1 and 2).
+	void setAttributesToUse(int shape, int size, int color);
+
+	static const int MAX_ATTRIBUTES = 8;
+	// must match PointsGlyph.vsh
+	static const int MAX_GLYPH_VERTICES = 48;
 private:
 	// structures to convey geometry to OpenGL/GLSL:
-	GLuint vao[1];
+	GLuint vao[2]; // [0]: one vertex per point; [1]: one instance per point
 	GLuint vertexBuffer[3];
+	GLuint previousPositionBuffer;
+	GLuint glyphTemplateBuffer; // uniform buffer for PointsGlyph.vsh
+	// this instance's PointsParameters uniform block (see PointsMV.vsh)
+	struct ParameterBlock;
+	GLuint parameterBuffer;
+	ParameterBlock* parameters; // as last written to parameterBuffer
+	// bitmask of selected points, read as a buffer texture by PointsMV.vsh
+	GLuint selectionBuffer, selectionTexture;
 
 	int nPoints;
 	GLenum mode;
 	double minMax[6];
+	float* mcPoints; // 3*nPoints
+	float* mcPrevious; // 3*nPoints; the start of the current transition
+	float transition; // 0 ==> at mcPrevious; 1 ==> at mcPoints
+	bool inTransition;
+	float* attributes; // MAX_ATTRIBUTES per point
+	int nAttributes; // the number that have been set
+	float attrMin[MAX_ATTRIBUTES], attrMax[MAX_ATTRIBUTES];
+	int useForShape, useForSize, useForColor;
+	// the variants of shaderIF's and glyphShaderIF's programs specialized
+	// for useForShape, etc. (see selectProgramVariants), and the
+	// shadersVersion they were selected under; 0 ==> select them again
+	GLuint pointsProgram, glyphProgram;
+	unsigned long programsVersion;
+
+	GlyphType glyphType;
+	int nTemplateVertices;
+	IconAtlas* icons;
+
+	// Spatial index over the LDS projections of mcPoints. Rebuilt lazily
+	// the first time it is queried after the view changes.
+	KDTree* ldsTree;
+	unsigned long ldsTreeVersion; // ModelView view version ldsTree was built for
+	int hoveredPoint;
+
+	Selection* selection;
+
+	const Variable* originalVars;
+	int nOriginalVars;
+
+	// Offscreen framebuffer for the point ID pass used by "picked":
+	GLuint pickFBO;
+	GLuint pickRenderBuffers[2]; // [0]: GL_R32UI point IDs; [1]: depth
+	int pickFBOWidth, pickFBOHeight;
 
 	static ShaderIF* shaderIF;
 	static int numInstances;
+	// increased each time the shaders are reloaded
+	static unsigned long shadersVersion;
+	// the programs (general or variant) whose uniforms were last set up by
+	// fetchGLSLVariableLocations
 	static GLuint shaderProgram;
-	static GLint pvaLoc_mcPosition, pvaLoc_pvaSet1, pvaLoc_pvaSet2;
-	static GLint ppuLoc_color, ppuLoc_mc_ec, ppuLoc_ec_lds;
-	static GLint ppuLoc_xFactor, ppuLoc_yFactor, ppuLoc_sizeFactor;
-	static GLint ppuLoc_attrToCutForCross, ppuLoc_attrToCutForHourglass, ppuLoc_attrToCutForCircle;
-	static GLint ppuLoc_attrToUseForShape, ppuLoc_attrToUseForSize, ppuLoc_attrToUseForColor;
-	static GLint ppuLoc_attrToCutForRed, ppuLoc_attrToCutForGreen;
-
-	void defineModel(const cryph::AffPoint* pts, float* sps, float* sz, float* crs);
+	static GLint pvaLoc_mcPosition, pvaLoc_pvaSet1, pvaLoc_pvaSet2, pvaLoc_mcPreviousPosition;
+	// (their other inputs are the ViewTransformation and PointsParameters
+	// uniform blocks, and the textures set by fetchGLSLVariableLocations)
+
+	// PointsGlyph.vsh with PointsMV.fsh
+	static ShaderIF* glyphShaderIF;
+	static GLuint glyphShaderProgram;
+
+	// PointsIcon.vsh with PointsIcon.fsh
+	static ShaderIF* iconShaderIF;
+	static GLuint iconShaderProgram;
+
+	void defineGlyphTemplate();
+	void defineModel(const cryph::Point3f* pts, float* sps, float* sz, float* crs);
+	void definePickFBO(int width, int height);
 	void normalAttributes();
+	int pickPoint(double ldsX, double ldsY);
+	void renderGlyphs();
+	void renderIcons();
+	void selectProgramVariants();
+	void updateAttributes();
+	void updateLDSTree();
+	void updateParameterBlock();
+	void updateSelectionBuffer();
 	static void fetchGLSLVariableLocations();
+	static void shadersReloaded(ShaderIF* reloaded, void* context);
 
 };
 
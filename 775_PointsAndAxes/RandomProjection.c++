@@ -0,0 +1,71 @@
+// RandomProjection.c++ -- A sparse random projection
+
+#include <cmath>
+#include <iostream>
+#include <random>
+
+#include "RandomProjection.h"
+
+RandomProjection::RandomProjection(int nDimensionsIn, int nComponentsIn, unsigned int seed) :
+	nDimensions(nDimensionsIn), nComponents(nComponentsIn)
+{
+	// entries are sqrt(3) * {+1, 0, -1} with probabilities {1/6, 2/3, 1/6}
+	scale = std::sqrt(3.0 / nComponents);
+	std::mt19937 generator(seed);
+	std::uniform_int_distribution<int> die(0, 5);
+	for (int c=0 ; c<nComponents ; c++)
+	{
+		plusStart.push_back(plus.size());
+		minusStart.push_back(minus.size());
+		// With few variables a component is all zero fairly often ((2/3)^4,
+		// about 20%, for 4), which would flatten its display axis; such a
+		// component is drawn again.
+		while ((nDimensions > 0) && (plus.size() == plusStart[c]) &&
+			(minus.size() == minusStart[c]))
+		{
+			for (int d=0 ; d<nDimensions ; d++)
+			{
+				int roll = die(generator);
+				if (roll == 0)
+					plus.push_back(d);
+				else if (roll == 1)
+					minus.push_back(d);
+			}
+		}
+	}
+	plusStart.push_back(plus.size());
+	minusStart.push_back(minus.size());
+}
+
+RandomProjection::~RandomProjection()
+{
+}
+
+void RandomProjection::reduce(float** vbls, int nDimensionsIn, int nSamples,
+	int nComponentsIn, float** result) const
+{
+	if (nDimensionsIn != nDimensions)
+	{
+		std::cerr << "RandomProjection::reduce: expected " << nDimensions
+		          << " dimensions, not " << nDimensionsIn << '\n';
+		return;
+	}
+	for (int s=0 ; s<nSamples ; s++)
+	{
+		const float* row = vbls[s];
+		for (int c=0 ; c<nComponentsIn ; c++)
+		{
+			if (c >= nComponents)
+			{
+				result[s][c] = 0.0;
+				continue;
+			}
+			float sum = 0.0;
+			for (int i=plusStart[c] ; i<plusStart[c+1] ; i++)
+				sum += row[plus[i]];
+			for (int i=minusStart[c] ; i<minusStart[c+1] ; i++)
+				sum -= row[minus[i]];
+			result[s][c] = scale * sum;
+		}
+	}
+}
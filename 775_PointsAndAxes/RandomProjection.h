@@ -0,0 +1,32 @@
+// RandomProjection.h -- A sparse random projection (Achlioptas, 2003). Each
+//                       component sums a random third (but at least one) of
+//                       the variables with random signs, so no covariance or
+//                       eigen-solve is needed, and each row costs
+//                       O(nDimensions*nComponents/3).
+
+#ifndef RANDOMPROJECTION_H
+#define RANDOMPROJECTION_H
+
+#include <vector>
+
+#include "Reducer.h"
+
+class RandomProjection : public Reducer
+{
+public:
+	RandomProjection(int nDimensionsIn, int nComponentsIn, unsigned int seed=1);
+	virtual ~RandomProjection();
+
+	virtual const char* getName() const { return "random projection"; }
+	virtual void reduce(float** vbls, int nDimensions, int nSamples,
+		int nComponents, float** result) const;
+
+private:
+	int nDimensions, nComponents;
+	float scale;
+	// for component c, the variables added and subtracted are
+	// plus[plusStart[c]..plusStart[c+1]) and minus[minusStart[c]..minusStart[c+1])
+	std::vector<int> plus, plusStart, minus, minusStart;
+};
+
+#endif
@@ -0,0 +1,26 @@
+// Reducer.h -- abstract base class for the dimensionality reduction engines
+//              that map each data row to the x, y, z, shape, size and color
+//              attributes of a point.
+
+#ifndef REDUCER_H
+#define REDUCER_H
+
+enum ReducerType
+{
+	PCA_REDUCER, RANDOM_PROJECTION_REDUCER, LANDMARK_MDS_REDUCER, TSNE_REDUCER
+};
+
+class Reducer
+{
+public:
+	virtual ~Reducer() {}
+
+	virtual const char* getName() const = 0;
+	// vbls: [nSamples][nDimensions], as for the PCA constructor.
+	// result: [nSamples][nComponents]; components the engine cannot
+	// produce are set to 0.
+	virtual void reduce(float** vbls, int nDimensions, int nSamples,
+		int nComponents, float** result) const = 0;
+};
+
+#endif
@@ -0,0 +1,250 @@
+// ScatterPlotController.c++ -- a Controller that can re-project its DataSet
+
+#include <algorithm>
+#include <cmath>
+
+#include <GL/gl.h>
+#include <GL/freeglut.h>
+
+#include "ScatterPlotController.h"
+#include "ParallelCoordsMV.h"
+#include "PointsMV.h"
+#include "ScatterPlotMatrixMV.h"
+#include "TSNE.h"
+
+// how long the points take to move to a new projection
+static const double TRANSITION_DURATION = 0.75; // seconds
+
+ScatterPlotController::ScatterPlotController(const std::string& name, int glutRCFlags,
+		DataSet* dataIn) :
+	Controller(name, glutRCFlags), data(dataIn), ptsmv(NULL),
+	pcmv(NULL), spmmv(NULL), view(SCATTER_PLOT_VIEW), reducerType(PCA_REDUCER), tsne(NULL),
+	tsneGeneration(0)
+{
+	int R = data->getNumRows();
+	pts = new cryph::Point3f[R];
+	sps = new float[R];
+	sz = new float[R];
+	crs = new float[R];
+}
+
+ScatterPlotController::~ScatterPlotController()
+{
+	stopTSNE();
+	delete [] pts;
+	delete [] sps;
+	delete [] sz;
+	delete [] crs;
+}
+
+void ScatterPlotController::handleKeyboard(unsigned char key, int x, int y)
+{
+	if ((key == 's') && (ptsmv != NULL))
+	{
+		std::vector<int> newSubset;
+		if (readVariableSubset(*data, newSubset))
+			setVariableSubset(newSubset);
+		glutPostRedisplay();
+	}
+	else if ((key == 'r') && (ptsmv != NULL))
+	{
+		setReducerType(static_cast<ReducerType>((reducerType + 1) % 4));
+		glutPostRedisplay();
+	}
+	else if (key == 'v')
+	{
+		// the next view that exists
+		ViewType next = view;
+		do
+			next = static_cast<ViewType>((next + 1) % 3);
+		while (((next == PARALLEL_COORDS_VIEW) && (pcmv == NULL)) ||
+		       ((next == SCATTER_PLOT_MATRIX_VIEW) && (spmmv == NULL)));
+		setView(next);
+		glutPostRedisplay();
+	}
+	else
+		Controller::handleKeyboard(key, x, y);
+}
+
+void ScatterPlotController::printKeyboardKeyList()
+{
+	std::cout << "ScatterPlotController:\n";
+	std::cout << "\ts - choose a different variable subset (in the terminal)\n";
+	std::cout << "\tr - cycle through PCA, random projection, landmark MDS and t-SNE\n";
+	std::cout << "\tv - cycle through the scatter plot, parallel coordinates and scatter plot matrix\n";
+	Controller::printKeyboardKeyList();
+}
+
+bool ScatterPlotController::readVariableSubset(const DataSet& data, std::vector<int>& subset)
+	// CLASS METHOD
+{
+	int varCount;
+	std::cout << "How many variables of original data set you want to use (prefer all of them):";
+	std::cin >> varCount;
+	std::cout << "\n";
+	std::cout << "Please include the variables' serial number you want to use (1 - Max), separate by space, then press enter." << std::endl;
+	std::cout << "include:";
+	subset.clear();
+	for (int i = 0; i < varCount; i++)
+	{
+		int varInclude;
+		std::cin >> varInclude;
+		subset.push_back(varInclude - 1);
+	}
+	if (!std::cin.good() || !data.validSubset(subset))
+	{
+		std::cerr << "Variable numbers must be between 1 and " << data.getNumVariables() << ".\n";
+		std::cin.clear();
+		return false;
+	}
+	return true;
+}
+
+void ScatterPlotController::setParallelCoordsMV(ParallelCoordsMV* pcmvIn)
+{
+	pcmv = pcmvIn;
+	setView(view);
+}
+
+void ScatterPlotController::setScatterPlotMatrixMV(ScatterPlotMatrixMV* spmmvIn)
+{
+	spmmv = spmmvIn;
+	setView(view);
+}
+
+void ScatterPlotController::setView(ViewType viewIn)
+{
+	view = viewIn;
+	ModelView* shown = NULL;
+	if (view == PARALLEL_COORDS_VIEW)
+		shown = pcmv;
+	else if (view == SCATTER_PLOT_MATRIX_VIEW)
+		shown = spmmv;
+	for (int i=0 ; i<static_cast<int>(models.size()) ; i++)
+	{
+		if (shown != NULL)
+			visible[i] = (models[i] == shown);
+		else
+			visible[i] = (models[i] != pcmv) && (models[i] != spmmv);
+	}
+}
+
+void ScatterPlotController::setPointsMV(PointsMV* ptsmvIn, const std::vector<int>& subsetIn)
+{
+	ptsmv = ptsmvIn;
+	subset = subsetIn;
+	updateGlyphAttributes();
+}
+
+void ScatterPlotController::reproject()
+{
+	stopTSNE();
+
+	// t-SNE only places the points; their shape, size and color attributes
+	// (and the initial extent) come from PCA.
+	ReducerType type = (reducerType == TSNE_REDUCER) ? PCA_REDUCER : reducerType;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	Reducer* reducer = data->createReducer(type, subset);
+	data->project(*reducer, subset, pts, sps, sz, crs);
+	std::chrono::duration<double, std::milli> elapsed =
+		std::chrono::steady_clock::now() - start;
+	std::cout << "Reduced " << data->getNumRows() << " rows of "
+	          << subset.size() << " variables with " << reducer->getName()
+	          << " in " << elapsed.count() << " ms\n";
+	delete reducer;
+	if (ptsmv != NULL)
+	{
+		// morph from the old projection to the new one
+		ptsmv->beginTransition();
+		ptsmv->updatePoints(pts, sps, sz, crs);
+		startAnimation(TRANSITION_DURATION);
+	}
+
+	if (reducerType == TSNE_REDUCER)
+	{
+		tsneExtent = 0.0;
+		for (int i=0 ; i<data->getNumRows() ; i++)
+			for (int k=0 ; k<3 ; k++)
+				tsneExtent = std::max(tsneExtent, (float)std::fabs(pts[i][k]));
+		tsneStart = std::chrono::steady_clock::now();
+		tsne = static_cast<TSNE*>(data->createReducer(TSNE_REDUCER, subset));
+		tsneShownIteration = -1;
+		tsne->start();
+		glutTimerFunc(TSNE_TIMER_INTERVAL, tsneTimerCB, ++tsneGeneration);
+	}
+}
+
+void ScatterPlotController::showTSNEProgress(int generation)
+{
+	if ((tsne == NULL) || (generation != tsneGeneration))
+		return;
+	int R = data->getNumRows();
+	bool finished = !tsne->isRunning();
+	std::vector<float> xyz(3*R);
+	int iteration = tsne->getEmbedding(&xyz[0]);
+	if ((iteration != tsneShownIteration) && (ptsmv != NULL))
+	{
+		float maxAbs = 0.0;
+		for (int i=0 ; i<3*R ; i++)
+			maxAbs = std::max(maxAbs, std::fabs(xyz[i]));
+		float scale = (maxAbs > 0.0) ? tsneExtent / maxAbs : 1.0;
+		for (int i=0 ; i<R ; i++)
+			pts[i] = cryph::Point3f(scale*xyz[3*i], scale*xyz[3*i+1], scale*xyz[3*i+2]);
+		ptsmv->updatePoints(pts, sps, sz, crs);
+		tsneShownIteration = iteration;
+		glutPostRedisplay();
+	}
+	if (!finished)
+		glutTimerFunc(TSNE_TIMER_INTERVAL, tsneTimerCB, generation);
+	else
+	{
+		std::chrono::duration<double, std::milli> elapsed =
+			std::chrono::steady_clock::now() - tsneStart;
+		std::cout << "t-SNE finished " << iteration << " iterations in "
+		          << elapsed.count() << " ms\n";
+	}
+}
+
+void ScatterPlotController::stopTSNE()
+{
+	if (tsne != NULL)
+	{
+		delete tsne; // (stops its optimizer thread)
+		tsne = NULL;
+	}
+}
+
+void ScatterPlotController::tsneTimerCB(int value) // CLASS METHOD
+{
+	ScatterPlotController* spc =
+		dynamic_cast<ScatterPlotController*>(Controller::getCurrentController());
+	if (spc != NULL)
+		spc->showTSNEProgress(value);
+}
+
+void ScatterPlotController::setReducerType(ReducerType type)
+{
+	reducerType = type;
+	reproject();
+}
+
+bool ScatterPlotController::setVariableSubset(const std::vector<int>& subsetIn)
+{
+	if (!data->validSubset(subsetIn))
+		return false;
+	subset = subsetIn;
+	reproject();
+	updateGlyphAttributes();
+	return true;
+}
+
+// The glyph attributes after the three reduced ones are the first few
+// variables of the subset themselves.
+void ScatterPlotController::updateGlyphAttributes()
+{
+	if (ptsmv == NULL)
+		return;
+	std::vector<float> values;
+	int n = data->getAttributeValues(subset, PointsMV::MAX_ATTRIBUTES - 3, values);
+	ptsmv->setExtraAttributes(values.data(), n);
+}
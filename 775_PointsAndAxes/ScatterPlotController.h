@@ -0,0 +1,85 @@
+// ScatterPlotController.h -- a Controller that can re-project its DataSet
+//                            onto the principal components of a different
+//                            subset of the variables, or with a different
+//                            Reducer, while running. A t-SNE embedding is
+//                            optimized in the background and animated. It
+//                            can also switch between the 3D scatter plot, a
+//                            parallel coordinates view and a scatter plot
+//                            matrix of the same data.
+
+#ifndef SCATTERPLOTCONTROLLER_H
+#define SCATTERPLOTCONTROLLER_H
+
+#include <chrono>
+#include <vector>
+
+#include "Controller.h"
+#include "DataSet.h"
+
+class ModelView;
+class ParallelCoordsMV;
+class PointsMV;
+class ScatterPlotMatrixMV;
+class TSNE;
+
+enum ViewType
+{
+	SCATTER_PLOT_VIEW, PARALLEL_COORDS_VIEW, SCATTER_PLOT_MATRIX_VIEW
+};
+
+class ScatterPlotController : public Controller
+{
+public:
+	ScatterPlotController(const std::string& name, int glutRCFlags, DataSet* dataIn);
+	virtual ~ScatterPlotController();
+
+	// ptsmvIn must currently show the projection for "subsetIn"
+	void setPointsMV(PointsMV* ptsmvIn, const std::vector<int>& subsetIn);
+	// Returns false if the subset is not valid for the DataSet
+	bool setVariableSubset(const std::vector<int>& subsetIn);
+	void setReducerType(ReducerType type);
+	// Each must have been added with addModel; they are initially hidden
+	void setParallelCoordsMV(ParallelCoordsMV* pcmvIn);
+	void setScatterPlotMatrixMV(ScatterPlotMatrixMV* spmmvIn);
+	// The parallel coordinates and scatter plot matrix views are shown
+	// alone; the scatter plot view is all the other models.
+	void setView(ViewType viewIn);
+
+	virtual void printKeyboardKeyList();
+
+	// Prompts for (1-based) variable numbers on std::cin; returns them 0-based
+	static bool readVariableSubset(const DataSet& data, std::vector<int>& subset);
+
+protected:
+	virtual void handleKeyboard(unsigned char key, int x, int y);
+
+private:
+	DataSet* data;
+	PointsMV* ptsmv;
+	ParallelCoordsMV* pcmv;
+	ScatterPlotMatrixMV* spmmv;
+	ViewType view;
+	std::vector<int> subset;
+	ReducerType reducerType;
+
+	// a t-SNE being optimized (if reducerType == TSNE_REDUCER)
+	TSNE* tsne;
+	int tsneShownIteration;
+	int tsneGeneration; // identifies the timer callbacks of the current TSNE
+	float tsneExtent; // the embedding is scaled to this max |coordinate|
+	std::chrono::steady_clock::time_point tsneStart;
+
+	void reproject();
+	void updateGlyphAttributes();
+	void showTSNEProgress(int generation);
+	void stopTSNE();
+
+	static void tsneTimerCB(int value);
+	static const int TSNE_TIMER_INTERVAL = 50; // milliseconds
+
+	// projection buffers; one entry per data row
+	cryph::Point3f* pts;
+	float *sps, *sz, *crs;
+};
+
+#endif
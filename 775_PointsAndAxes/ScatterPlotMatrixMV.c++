@@ -0,0 +1,325 @@
+// ScatterPlotMatrixMV.c++
+
+#include <cmath>
+#include <iostream>
+
+#include "ScatterPlotMatrixMV.h"
+#include "Controller.h"
+#include "DataSet.h"
+#include "ShaderIF.h"
+
+ShaderIF* ScatterPlotMatrixMV::shaderIF = NULL;
+ShaderIF* ScatterPlotMatrixMV::cellShaderIF = NULL;
+int ScatterPlotMatrixMV::numInstances = 0;
+GLuint ScatterPlotMatrixMV::shaderProgram = 0;
+GLuint ScatterPlotMatrixMV::cellShaderProgram = 0;
+GLint ScatterPlotMatrixMV::ppuLoc_cells = -1;
+GLint ScatterPlotMatrixMV::ppuLoc_nVariables = -1;
+GLint ScatterPlotMatrixMV::ppuLoc_gridSide = -1;
+GLint ScatterPlotMatrixMV::ppuLoc_mcBounds = -1;
+GLint ScatterPlotMatrixMV::ppuLoc_mcZ = -1;
+GLint ScatterPlotMatrixMV::ppuLoc_mc_ec = -1;
+GLint ScatterPlotMatrixMV::ppuLoc_ec_lds = -1;
+GLint ScatterPlotMatrixMV::ppuLoc_cellCache = -1;
+GLint ScatterPlotMatrixMV::ppuLoc_cellValues = -1;
+GLint ScatterPlotMatrixMV::ppuLoc_cellNRows = -1;
+GLint ScatterPlotMatrixMV::ppuLoc_cellCells = -1;
+GLint ScatterPlotMatrixMV::ppuLoc_cellGridSide = -1;
+GLint ScatterPlotMatrixMV::ppuLoc_cellMargin = -1;
+GLint ScatterPlotMatrixMV::ppuLoc_cellColor = -1;
+
+// blank border around the plot in each cell (fraction of the cell)
+static const float CELL_MARGIN = 0.05;
+
+// Points are drawn with an opacity of about this many rows' worth divided
+// by the number of rows.
+static const float OPAQUE_ROWS = 200.0;
+static const float MIN_POINT_ALPHA = 0.05;
+
+ScatterPlotMatrixMV::ScatterPlotMatrixMV(const DataSet& data) :
+	cacheFBO(0), cacheTexture(0), nRows(data.getNumRows()), nVariables(data.getNumVariables())
+{
+	if (ScatterPlotMatrixMV::shaderProgram == 0)
+	{
+		// create the shader programs:
+		ScatterPlotMatrixMV::shaderIF =
+			new ShaderIF("ScatterPlotMatrixMV.vsh", "ScatterPlotMatrixMV.fsh");
+		ScatterPlotMatrixMV::shaderProgram = shaderIF->getShaderPgmID();
+		ScatterPlotMatrixMV::cellShaderIF = new ShaderIF("ScatterPlotMatrixCell.vsh", "AxesMV.fsh");
+		ScatterPlotMatrixMV::cellShaderProgram = cellShaderIF->getShaderPgmID();
+		fetchGLSLVariableLocations();
+	}
+
+	pointAlpha = (nRows > 0) ? OPAQUE_ROWS / nRows : 1.0;
+	if (pointAlpha > 1.0)
+		pointAlpha = 1.0;
+	else if (pointAlpha < MIN_POINT_ALPHA)
+		pointAlpha = MIN_POINT_ALPHA;
+
+	// Now do instance-specific initialization:
+	defineModel(data);
+	ScatterPlotMatrixMV::numInstances++;
+}
+
+ScatterPlotMatrixMV::~ScatterPlotMatrixMV()
+{
+	glDeleteTextures(1, &valueTexture);
+	glDeleteTextures(1, &cellTexture);
+	glDeleteBuffers(1, &valueBuffer);
+	glDeleteBuffers(1, &cellBuffer);
+	glDeleteVertexArrays(1, vao);
+	glDeleteFramebuffers(1, &cacheFBO);
+	glDeleteTextures(1, &cacheTexture);
+	if (--ScatterPlotMatrixMV::numInstances == 0)
+	{
+		ScatterPlotMatrixMV::shaderIF->destroy();
+		delete ScatterPlotMatrixMV::shaderIF;
+		ScatterPlotMatrixMV::shaderIF = NULL;
+		ScatterPlotMatrixMV::shaderProgram = 0;
+		ScatterPlotMatrixMV::cellShaderIF->destroy();
+		delete ScatterPlotMatrixMV::cellShaderIF;
+		ScatterPlotMatrixMV::cellShaderIF = NULL;
+		ScatterPlotMatrixMV::cellShaderProgram = 0;
+	}
+}
+
+// Renders the given cells (variable on x, variable on y, slot, unused)
+// into their slots of cacheTexture
+void ScatterPlotMatrixMV::cacheCells(const std::vector<GLint>& cells)
+{
+	GLint vp[4], prevFBO;
+	glGetIntegerv(GL_VIEWPORT, vp);
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, cacheFBO);
+	glViewport(0, 0, gridSide*cellSize, gridSide*cellSize);
+
+	// clear just the cells being drawn
+	GLfloat white[4] = { 1.0, 1.0, 1.0, 1.0 };
+	glEnable(GL_SCISSOR_TEST);
+	for (int c=0 ; c<static_cast<int>(cells.size()) ; c+=4)
+	{
+		int slot = cells[c+2];
+		glScissor((slot % gridSide) * cellSize, (slot / gridSide) * cellSize, cellSize, cellSize);
+		glClearBufferfv(GL_COLOR, 0, white);
+	}
+	glDisable(GL_SCISSOR_TEST);
+
+	glUseProgram(cellShaderProgram);
+	uploadCells(cells);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_BUFFER, valueTexture);
+	glUniform1i(ppuLoc_cellValues, 0);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_BUFFER, cellTexture);
+	glUniform1i(ppuLoc_cellCells, 1);
+	glActiveTexture(GL_TEXTURE0);
+	glUniform1i(ppuLoc_cellNRows, nRows);
+	glUniform1i(ppuLoc_cellGridSide, gridSide);
+	glUniform1f(ppuLoc_cellMargin, CELL_MARGIN);
+	glUniform4f(ppuLoc_cellColor, 0.0, 0.0, 0.6, pointAlpha);
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glPointSize((cellSize >= 128) ? 2.0 : 1.0);
+	glDrawArraysInstanced(GL_POINTS, 0, nRows, cells.size()/4);
+	glDisable(GL_BLEND);
+
+	glBindTexture(GL_TEXTURE_2D, cacheTexture);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, prevFBO);
+	glViewport(vp[0], vp[1], vp[2], vp[3]);
+}
+
+void ScatterPlotMatrixMV::defineModel(const DataSet& data)
+{
+	glGenVertexArrays(1, vao);
+
+	glGenBuffers(1, &valueBuffer);
+	glGenTextures(1, &valueTexture);
+	updateValues(data);
+	glBindTexture(GL_TEXTURE_BUFFER, valueTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, valueBuffer);
+
+	glGenBuffers(1, &cellBuffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, cellBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, 4*sizeof(GLint), NULL, GL_STREAM_DRAW);
+	glGenTextures(1, &cellTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, cellTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32I, cellBuffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	// the cell cache: as square a grid of slots as possible
+	int nSlots = nVariables * (nVariables + 1) / 2;
+	gridSide = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(nSlots))));
+	if (gridSide < 1)
+		gridSide = 1;
+	cellSize = MAX_CACHE_SIZE / gridSide;
+	if (cellSize > MAX_CELL_SIZE)
+		cellSize = MAX_CELL_SIZE;
+	cached.assign(nSlots, false);
+
+	glGenTextures(1, &cacheTexture);
+	glBindTexture(GL_TEXTURE_2D, cacheTexture);
+	int levels = 1;
+	for (int size=gridSide*cellSize ; size>1 ; size/=2)
+		levels++;
+	glTexStorage2D(GL_TEXTURE_2D, levels, GL_RGBA8, gridSide*cellSize, gridSide*cellSize);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	GLint prevFBO;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFBO);
+	glGenFramebuffers(1, &cacheFBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, cacheFBO);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, cacheTexture, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cerr << "ScatterPlotMatrixMV::defineModel: incomplete framebuffer\n";
+	glBindFramebuffer(GL_FRAMEBUFFER, prevFBO);
+}
+
+void ScatterPlotMatrixMV::fetchGLSLVariableLocations()
+{
+	if (ScatterPlotMatrixMV::shaderProgram > 0)
+	{
+		ppuLoc_cells = ppUniformLocation(shaderProgram, "cells");
+		ppuLoc_nVariables = ppUniformLocation(shaderProgram, "nVariables");
+		ppuLoc_gridSide = ppUniformLocation(shaderProgram, "gridSide");
+		ppuLoc_mcBounds = ppUniformLocation(shaderProgram, "mcBounds");
+		ppuLoc_mcZ = ppUniformLocation(shaderProgram, "mcZ");
+		ppuLoc_mc_ec = ppUniformLocation(shaderProgram, "mc_ec");
+		ppuLoc_ec_lds = ppUniformLocation(shaderProgram, "ec_lds");
+		ppuLoc_cellCache = ppUniformLocation(shaderProgram, "cellCache");
+	}
+	if (ScatterPlotMatrixMV::cellShaderProgram > 0)
+	{
+		ppuLoc_cellValues = ppUniformLocation(cellShaderProgram, "values");
+		ppuLoc_cellNRows = ppUniformLocation(cellShaderProgram, "nRows");
+		ppuLoc_cellCells = ppUniformLocation(cellShaderProgram, "cells");
+		ppuLoc_cellGridSide = ppUniformLocation(cellShaderProgram, "gridSide");
+		ppuLoc_cellMargin = ppUniformLocation(cellShaderProgram, "cellMargin");
+		ppuLoc_cellColor = ppUniformLocation(cellShaderProgram, "color");
+	}
+}
+
+// xyzLimits: {mcXmin, mcXmax, mcYmin, mcYmax, mcZmin, mcZmax}
+void ScatterPlotMatrixMV::getMCBoundingBox(double* xyzLimits) const
+{
+	// An empty box (min > max): the matrix fills whatever region of
+	// interest the 3D models determine.
+	for (int i=0 ; i<6 ; i+=2)
+	{
+		xyzLimits[i] = 1.0;
+		xyzLimits[i+1] = -1.0;
+	}
+}
+
+void ScatterPlotMatrixMV::render()
+{
+	if ((nRows <= 0) || (nVariables <= 0))
+		return;
+
+	// save the current GLSL program in use
+	GLint pgm;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &pgm);
+
+	const ModelView::ViewState& view = ModelView::getViewState();
+
+	double xyz[6];
+	Controller::getCurrentController()->getMCRegionOfInterest(xyz);
+	float mcBounds[4] = { static_cast<float>(xyz[0]), static_cast<float>(xyz[1]),
+		static_cast<float>(xyz[2]), static_cast<float>(xyz[3]) };
+	float mcZ = 0.5 * (xyz[4] + xyz[5]);
+
+	// Cull cells entirely outside one of the side planes of the view volume.
+	// Each drawn cell is (column, row, slot, transposed).
+	std::vector<GLint> cells, uncached;
+	float dx = (mcBounds[1] - mcBounds[0]) / nVariables;
+	float dy = (mcBounds[3] - mcBounds[2]) / nVariables;
+	for (int row=0 ; row<nVariables ; row++)
+	{
+		float y0 = mcBounds[2] + (nVariables - 1 - row) * dy;
+		for (int col=0 ; col<nVariables ; col++)
+		{
+			float x0 = mcBounds[0] + col * dx;
+			bool culled = false;
+			for (int p=0 ; (p<4) && !culled ; p++) // left, right, bottom, top
+			{
+				const double* plane = view.frustumPlanes[p];
+				int outside = 0;
+				for (int k=0 ; k<4 ; k++)
+				{
+					double x = x0 + (k & 1) * dx, y = y0 + (k >> 1) * dy;
+					outside += (plane[0]*x + plane[1]*y + plane[2]*mcZ + plane[3] < 0.0);
+				}
+				culled = (outside == 4);
+			}
+			if (culled)
+				continue;
+			int i = (row < col) ? row : col, j = (row < col) ? col : row;
+			int slot = j*(j+1)/2 + i;
+			if (!cached[slot])
+			{
+				GLint cell[4] = { j, i, slot, 0 };
+				uncached.insert(uncached.end(), cell, cell+4);
+				cached[slot] = true;
+			}
+			GLint cell[4] = { col, row, slot, (col < row) ? 1 : 0 };
+			cells.insert(cells.end(), cell, cell+4);
+		}
+	}
+	if (cells.empty())
+		return;
+	if (!uncached.empty())
+		cacheCells(uncached);
+
+	glUseProgram(shaderProgram);
+	uploadCells(cells);
+	glBindVertexArray(vao[0]);
+	glUniformMatrix4fv(ppuLoc_mc_ec, 1, false, view.mc_ec);
+	glUniformMatrix4fv(ppuLoc_ec_lds, 1, false, view.ec_lds);
+	glUniform4fv(ppuLoc_mcBounds, 1, mcBounds);
+	glUniform1f(ppuLoc_mcZ, mcZ);
+	glUniform1i(ppuLoc_nVariables, nVariables);
+	glUniform1i(ppuLoc_gridSide, gridSide);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, cacheTexture);
+	glUniform1i(ppuLoc_cellCache, 0);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_BUFFER, cellTexture);
+	glUniform1i(ppuLoc_cells, 1);
+	glActiveTexture(GL_TEXTURE0);
+
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, cells.size()/4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// restore the previous program
+	glUseProgram(pgm);
+}
+
+// Replaces the contents of cellBuffer (4 ints per cell)
+void ScatterPlotMatrixMV::uploadCells(const std::vector<GLint>& cells)
+{
+	glBindBuffer(GL_TEXTURE_BUFFER, cellBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, cells.size()*sizeof(GLint), &cells[0], GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	glBindVertexArray(vao[0]);
+}
+
+void ScatterPlotMatrixMV::updateValues(const DataSet& data)
+{
+	// stored by column so that each cell reads two contiguous runs
+	float* values = new float[nRows*nVariables];
+	for (int j=0 ; j<nVariables ; j++)
+		data.getNormalizedValues(j, &values[j*nRows]);
+	glBindBuffer(GL_TEXTURE_BUFFER, valueBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, nRows*nVariables*sizeof(float), values, GL_STATIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	delete [] values;
+	cached.assign(cached.size(), false);
+}
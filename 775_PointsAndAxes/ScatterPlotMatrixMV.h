@@ -0,0 +1,74 @@
+// ScatterPlotMatrixMV.h -- The N x N matrix of pairwise scatter plots of the
+//                          normalized variables of a DataSet. The values are
+//                          uploaded once, by column, as a buffer texture read
+//                          by every cell. Cells are rendered into a texture
+//                          cache (each unordered pair once; the mirror-image
+//                          cell samples it transposed) only when first seen
+//                          after the data change, and each frame then just
+//                          draws one textured quad per cell that is not
+//                          culled by the current view.
+//
+//                          The matrix fills the Controller's MC region of
+//                          interest (in the plane z = its middle) and so can be zoomed and
+//                          panned; it contributes nothing to the overall MC
+//                          bounding box.
+
+#ifndef SCATTERPLOTMATRIXMV_H
+#define SCATTERPLOTMATRIXMV_H
+
+class DataSet;
+class ShaderIF;
+
+#include <vector>
+#include <GL/gl.h>
+
+#include "ModelView.h"
+
+class ScatterPlotMatrixMV : public ModelView
+{
+public:
+	ScatterPlotMatrixMV(const DataSet& data);
+	virtual ~ScatterPlotMatrixMV();
+
+	// xyzLimits: {mcXmin, mcXmax, mcYmin, mcYmax, mcZmin, mcZmax}
+	void getMCBoundingBox(double* xyzLimitsF) const;
+	void render();
+
+	// Replace the normalized values with those of "data" (same number of
+	// rows and variables); every cached cell is re-rendered when next visible.
+	void updateValues(const DataSet& data);
+
+	// the largest cache texture dimension and the largest cell in it
+	static const int MAX_CACHE_SIZE = 2048;
+	static const int MAX_CELL_SIZE = 256;
+
+private:
+	GLuint vao[1];
+	GLuint valueBuffer, valueTexture; // normalized values; nRows per variable
+	GLuint cellBuffer, cellTexture; // the cells of the current draw call
+
+	// The cell cache: slot k holds the cell of variables (i,j), i <= j,
+	// with k = j*(j+1)/2 + i, plotting j on x and i on y.
+	GLuint cacheFBO, cacheTexture;
+	int gridSide, cellSize;
+	std::vector<bool> cached; // by slot
+
+	int nRows, nVariables;
+	float pointAlpha;
+
+	static ShaderIF* shaderIF;
+	static ShaderIF* cellShaderIF;
+	static int numInstances;
+	static GLuint shaderProgram, cellShaderProgram;
+	static GLint ppuLoc_cells, ppuLoc_nVariables, ppuLoc_gridSide;
+	static GLint ppuLoc_mcBounds, ppuLoc_mcZ, ppuLoc_mc_ec, ppuLoc_ec_lds, ppuLoc_cellCache;
+	static GLint ppuLoc_cellValues, ppuLoc_cellNRows, ppuLoc_cellCells, ppuLoc_cellGridSide;
+	static GLint ppuLoc_cellMargin, ppuLoc_cellColor;
+
+	void cacheCells(const std::vector<GLint>& cells);
+	void defineModel(const DataSet& data);
+	void uploadCells(const std::vector<GLint>& cells);
+	static void fetchGLSLVariableLocations();
+};
+
+#endif
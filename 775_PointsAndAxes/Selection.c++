@@ -0,0 +1,118 @@
+// Selection.c++ -- A set of selected points stored as a bitmask
+
+#include <algorithm>
+#include <cmath>
+
+#include "Selection.h"
+
+Selection::Selection(int nPointsIn) : nPoints(nPointsIn), nSelected(0)
+{
+	if (nPoints < 0)
+		nPoints = 0;
+	// always keep at least one word so that getWords is valid
+	words.assign((nPoints + 31) / 32 + ((nPoints == 0) ? 1 : 0), 0u);
+}
+
+Selection::~Selection()
+{
+}
+
+void Selection::clear()
+{
+	if (nSelected == 0)
+		return;
+	for (int w=0 ; w<words.size() ; w++)
+		if (words[w] != 0)
+			setWord(w, 0u);
+	nSelected = 0;
+}
+
+void Selection::clearChanges()
+{
+	changedWords.clear();
+}
+
+void Selection::getChangedWordRanges(std::vector<std::pair<int,int> >& ranges, int minGap) const
+{
+	std::vector<int> changed(changedWords);
+	std::sort(changed.begin(), changed.end());
+	for (std::vector<int>::iterator it=changed.begin() ; it<changed.end() ; it++)
+	{
+		if (!ranges.empty() && (*it - ranges.back().second <= minGap))
+			ranges.back().second = *it;
+		else
+			ranges.push_back(std::make_pair(*it, *it));
+	}
+}
+
+void Selection::getMeans(const Variable* vars, int nVars, float* means) const
+{
+	std::vector<double> sums(nVars, 0.0);
+	std::vector<int> counts(nVars, 0);
+	for (int w=0 ; w<words.size() ; w++)
+	{
+		unsigned int bits = words[w];
+		while (bits != 0)
+		{
+			int i = 32*w + __builtin_ctz(bits);
+			bits &= bits - 1;
+			for (int v=0 ; v<nVars ; v++)
+			{
+				float value = vars[v].getValue(i);
+				if (!std::isnan(value)) // (missing)
+				{
+					sums[v] += value;
+					counts[v]++;
+				}
+			}
+		}
+	}
+	for (int v=0 ; v<nVars ; v++)
+		means[v] = (counts[v] == 0) ? 0.0 : sums[v] / counts[v];
+}
+
+void Selection::getSelected(std::vector<int>& result) const
+{
+	for (int w=0 ; w<words.size() ; w++)
+	{
+		unsigned int bits = words[w];
+		while (bits != 0)
+		{
+			result.push_back(32*w + __builtin_ctz(bits));
+			bits &= bits - 1;
+		}
+	}
+}
+
+void Selection::select(const std::vector<int>& indices, SelectionOp op)
+{
+	if (op == REPLACE_SELECTION)
+	{
+		clear();
+		op = ADD_TO_SELECTION;
+	}
+	for (std::vector<int>::const_iterator it=indices.begin() ; it<indices.end() ; it++)
+	{
+		int i = *it;
+		if ((i < 0) || (i >= nPoints))
+			continue;
+		unsigned int bit = 1u << (i & 31);
+		unsigned int word = words[i >> 5];
+		if ((op == ADD_TO_SELECTION) && ((word & bit) == 0))
+		{
+			setWord(i >> 5, word | bit);
+			nSelected++;
+		}
+		else if ((op == REMOVE_FROM_SELECTION) && ((word & bit) != 0))
+		{
+			setWord(i >> 5, word & ~bit);
+			nSelected--;
+		}
+	}
+}
+
+void Selection::setWord(int w, unsigned int newBits)
+{
+	words[w] = newBits;
+	changedWords.push_back(w);
+}
@@ -0,0 +1,54 @@
+// Selection.h -- A set of selected points stored as a bitmask, one bit per
+//                point packed into 32-bit words. Changes are tracked per word
+//                so that a GPU copy of the mask can be updated incrementally.
+
+#ifndef SELECTION_H
+#define SELECTION_H
+
+#include <vector>
+
+#include "Variable.h"
+
+enum SelectionOp
+{
+	REPLACE_SELECTION, ADD_TO_SELECTION, REMOVE_FROM_SELECTION
+};
+
+class Selection
+{
+public:
+	Selection(int nPointsIn);
+	virtual ~Selection();
+
+	void clear();
+	void select(const std::vector<int>& indices, SelectionOp op);
+
+	bool isSelected(int i) const { return (words[i >> 5] & (1u << (i & 31))) != 0; }
+	int getNumPoints() const { return nPoints; }
+	int getNumSelected() const { return nSelected; }
+	int getNumWords() const { return words.size(); }
+	const unsigned int* getWords() const { return &words[0]; }
+
+	// Appends the indices of all selected points, in increasing order
+	void getSelected(std::vector<int>& result) const;
+	// means[v] = mean over the selection of the non-missing vars[v].value
+	// (0 if there are none). Cost is proportional to the number of selected points
+	// times nVars, plus a scan that skips 32 unselected points at a time.
+	void getMeans(const Variable* vars, int nVars, float* means) const;
+
+	// Word index ranges changed since the last call to clearChanges, sorted
+	// and merged. Runs closer together than minGap words are coalesced.
+	void getChangedWordRanges(std::vector<std::pair<int,int> >& ranges, int minGap=16) const;
+	void clearChanges();
+
+private:
+	Selection(const Selection& s) {} // do not allow copies
+
+	int nPoints, nSelected;
+	std::vector<unsigned int> words;
+	std::vector<int> changedWords; // may contain duplicates
+
+	void setWord(int w, unsigned int newBits);
+};
+
+#endif
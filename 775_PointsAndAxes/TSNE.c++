@@ -0,0 +1,621 @@
+// TSNE.c++ -- Barnes-Hut t-SNE embedding into 3D
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+
+#include "TSNE.h"
+
+int TSNE::numThreads = 0;
+
+static const int EXAGGERATION_ITERATIONS = 250;
+static const float EXAGGERATION = 12.0;
+// Barnes-Hut accuracy; 0 ==> exact. Cells per query grow as 1/THETA^3 in 3D,
+// so this is larger than the 0.5 commonly used for 2D embeddings.
+static const float THETA = 0.8;
+static const int MAX_OCTREE_DEPTH = 32;
+// Approximate k-NN: a forest of random projection trees proposes the other
+// points in each of a point's leaves as candidate neighbors; rounds of
+// neighbor-of-neighbor exploration (as in LargeVis) then refine them.
+static const int RP_TREES = 8;
+static const int RP_LEAF_SIZE = 128; // (at least K+1)
+static const int REFINE_ROUNDS = 1;
+static const int REFINE_FANOUT = 20; // closest neighbors of the closest neighbors
+
+// Run f(thread, begin, end) over [0, n) split evenly among nThreads threads
+static void parallelFor(int n, int nThreads, const std::function<void(int,int,int)>& f)
+{
+	if ((nThreads <= 1) || (n < 2*nThreads))
+	{
+		f(0, 0, n);
+		return;
+	}
+	std::vector<std::thread> threads;
+	for (int t=1 ; t<nThreads ; t++)
+		threads.push_back(std::thread(f, t, (long)n*t/nThreads, (long)n*(t+1)/nThreads));
+	f(0, 0, n/nThreads);
+	for (int t=0 ; t<threads.size() ; t++)
+		threads[t].join();
+}
+
+// Squared distance between rows i and j of the dim-column "coords"
+static float distanceSquared(const float* coords, int dim, int i, int j)
+{
+	const float* a = &coords[i*dim];
+	const float* b = &coords[j*dim];
+	float d2 = 0.0;
+	for (int d=0 ; d<dim ; d++)
+		d2 += (a[d] - b[d]) * (a[d] - b[d]);
+	return d2;
+}
+
+// Adds j to the K neighbors (closest first) in dist2/idx unless it is no
+// closer than all of them or is already there.
+static void insertNeighbor(float* dist2, int* idx, int K, float d2, int j)
+{
+	if (d2 >= dist2[K-1])
+		return;
+	int k = std::upper_bound(dist2, dist2+K-1, d2) - dist2;
+	// j already there would be at the same distance, just before k
+	for (int m=k-1 ; (m >= 0) && (dist2[m] == d2) ; m--)
+		if (idx[m] == j)
+			return;
+	std::copy_backward(dist2+k, dist2+K-1, dist2+K);
+	std::copy_backward(idx+k, idx+K-1, idx+K);
+	dist2[k] = d2;
+	idx[k] = j;
+}
+
+// Splits perm[begin, end) by random hyperplanes (each the perpendicular
+// bisector of two of its points) until no part has more than leafSize
+// points; the end of each leaf is appended to leafEnds.
+static void buildRPTree(const float* coords, int dim, int* perm, int begin, int end,
+	int leafSize, std::mt19937& generator, std::vector<int>& leafEnds)
+{
+	std::vector<std::pair<int,int> > pending(1, std::make_pair(begin, end));
+	std::vector<float> normal(dim);
+	while (!pending.empty())
+	{
+		begin = pending.back().first;
+		end = pending.back().second;
+		pending.pop_back();
+		int n = end - begin;
+		if (n <= leafSize)
+		{
+			leafEnds.push_back(end);
+			continue;
+		}
+		const float* a = &coords[perm[begin + generator() % n] * dim];
+		const float* b = &coords[perm[begin + generator() % n] * dim];
+		float offset = 0.0;
+		for (int d=0 ; d<dim ; d++)
+		{
+			normal[d] = a[d] - b[d];
+			offset += normal[d] * 0.5 * (a[d] + b[d]);
+		}
+		int* mid = std::partition(perm+begin, perm+end,
+			[&](int i)
+			{
+				const float* x = &coords[i*dim];
+				float dot = 0.0;
+				for (int d=0 ; d<dim ; d++)
+					dot += normal[d] * x[d];
+				return dot < offset;
+			});
+		int split = mid - perm;
+		if ((split == begin) || (split == end)) // (near) duplicates
+			split = begin + n/2;
+		// the second half is pushed first so that leaves come out in order
+		pending.push_back(std::make_pair(split, end));
+		pending.push_back(std::make_pair(begin, split));
+	}
+}
+
+TSNE::TSNE(float** vbls, int nDimensionsIn, int nSamplesIn,
+		double perplexityIn, int nIterationsIn, unsigned int seed) :
+	nSamples(nSamplesIn), nDimensions(nDimensionsIn), perplexity(perplexityIn),
+	nIterations(nIterationsIn), seed(seed),
+	iteration(0), running(false), stopRequested(false),
+	coords(nSamplesIn * nDimensionsIn), haveSimilarities(false),
+	Y(3*nSamplesIn), gains(3*nSamplesIn, 1.0), update(3*nSamplesIn, 0.0),
+	gradient(3*nSamplesIn), publishedIteration(-1)
+{
+	// The similarities are left to run(), off the caller's thread.
+	for (int i=0 ; i<nSamples ; i++)
+		std::copy(vbls[i], vbls[i]+nDimensions, &coords[i*nDimensions]);
+	std::mt19937 generator(seed);
+	std::normal_distribution<float> gaussian(0.0, 1.0e-4);
+	for (int i=0 ; i<3*nSamples ; i++)
+		Y[i] = gaussian(generator);
+	published = Y;
+	if (nSamples <= 1)
+		nIterations = 0;
+}
+
+TSNE::~TSNE()
+{
+	stop();
+}
+
+void TSNE::buildOctree()
+{
+	float lo[3], hi[3];
+	for (int d=0 ; d<3 ; d++)
+		lo[d] = hi[d] = Y[d];
+	for (int i=1 ; i<nSamples ; i++)
+		for (int d=0 ; d<3 ; d++)
+		{
+			lo[d] = std::min(lo[d], Y[3*i+d]);
+			hi[d] = std::max(hi[d], Y[3*i+d]);
+		}
+	Cell root;
+	root.halfWidth = 0.0;
+	for (int d=0 ; d<3 ; d++)
+	{
+		root.center[d] = 0.5 * (lo[d] + hi[d]);
+		root.halfWidth = std::max(root.halfWidth, 0.5f * (hi[d] - lo[d]));
+		root.com[d] = 0.0;
+	}
+	root.halfWidth = root.halfWidth * 1.001 + 1.0e-5;
+	root.count = 0;
+	root.point = -1;
+	for (int c=0 ; c<8 ; c++)
+		root.child[c] = -1;
+
+	octree.clear();
+	octree.reserve(2*nSamples);
+	octree.push_back(root);
+	for (int i=0 ; i<nSamples ; i++)
+		insert(0, i, 0);
+}
+
+void TSNE::computeGradient(bool exaggerate)
+{
+	buildOctree();
+
+	int nThreads = getNumThreads();
+	std::vector<double> sumQ(nThreads, 0.0);
+	std::vector<float> repulsive(3*nSamples);
+	float exaggeration = exaggerate ? EXAGGERATION : 1.0;
+	parallelFor(nSamples, nThreads,
+		[&](int thread, int begin, int end)
+		{
+			double mySumQ = 0.0;
+			for (int i=begin ; i<end ; i++)
+			{
+				repulsion(i, &repulsive[3*i], mySumQ);
+
+				// attractive forces along the edges of the k-NN graph
+				const float* yi = &Y[3*i];
+				float attractive[3] = { 0.0, 0.0, 0.0 };
+				for (int e=rowStart[i] ; e<rowStart[i+1] ; e++)
+				{
+					const float* yj = &Y[3*column[e]];
+					float d[3] = { yi[0]-yj[0], yi[1]-yj[1], yi[2]-yj[2] };
+					float q = 1.0 / (1.0 + d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+					float pq = exaggeration * P[e] * q;
+					for (int k=0 ; k<3 ; k++)
+						attractive[k] += pq * d[k];
+				}
+				for (int k=0 ; k<3 ; k++)
+					gradient[3*i+k] = attractive[k];
+			}
+			sumQ[thread] = mySumQ;
+		});
+
+	double Z = 0.0;
+	for (int t=0 ; t<nThreads ; t++)
+		Z += sumQ[t];
+	float invZ = (Z > 0.0) ? 1.0/Z : 0.0;
+	for (int i=0 ; i<3*nSamples ; i++)
+		gradient[i] = 4.0 * (gradient[i] - repulsive[i] * invZ);
+}
+
+bool TSNE::computeSimilarities()
+{
+	int K = std::min(nSamples-1, (int)(3.0*perplexity));
+	std::vector<int> neighbors;
+	std::vector<float> neighborDist2;
+	if (!findNeighbors(K, neighbors, neighborDist2))
+		return false;
+
+	// conditional distributions p(j|i) over each row's K nearest neighbors,
+	// with the Gaussian width chosen to match the perplexity
+	std::vector<float> conditional(nSamples * K, 0.0);
+	double targetEntropy = std::log(perplexity);
+	parallelFor(nSamples, getNumThreads(),
+		[&](int thread, int begin, int end)
+		{
+			std::vector<double> p(K);
+			for (int i=begin ; (i<end) && !stopRequested ; i++)
+			{
+				// any places not filled hold i itself: p(i|i) stays 0
+				std::vector<float> dist2;
+				for (int k=0 ; (k<K) && (neighbors[i*K+k] != i) ; k++)
+					dist2.push_back(neighborDist2[i*K+k]);
+				if (dist2.empty())
+					continue;
+
+				double beta = 1.0, betaLo = 0.0;
+				double betaHi = std::numeric_limits<double>::max();
+				double sum = 0.0;
+				for (int attempt=0 ; attempt<200 ; attempt++)
+				{
+					sum = 0.0;
+					double weighted = 0.0;
+					for (int k=0 ; k<dist2.size() ; k++)
+					{
+						double dk = dist2[k] - dist2[0]; // for numerical stability
+						p[k] = std::exp(-beta * dk);
+						sum += p[k];
+						weighted += dk * p[k];
+					}
+					double entropy = std::log(sum) + beta * weighted / sum;
+					if (std::fabs(entropy - targetEntropy) < 1.0e-5)
+						break;
+					if (entropy > targetEntropy)
+					{
+						betaLo = beta;
+						beta = (betaHi == std::numeric_limits<double>::max()) ?
+							2.0*beta : 0.5*(beta + betaHi);
+					}
+					else
+					{
+						betaHi = beta;
+						beta = 0.5 * (beta + betaLo);
+					}
+				}
+				for (int k=0 ; k<dist2.size() ; k++)
+					conditional[i*K+k] = p[k] / sum;
+			}
+		});
+	if (stopRequested)
+		return false;
+
+	// Symmetrize: P(i,j) = (p(j|i) + p(i|j)) / 2N. Rather than merging,
+	// row i simply lists each of its own neighbors and each row that has i
+	// as a neighbor; an (i,j) pair in both lists then contributes both terms.
+	std::vector<int> reverseCount(nSamples, 0);
+	for (int e=0 ; e<nSamples*K ; e++)
+		reverseCount[neighbors[e]]++;
+	rowStart.resize(nSamples+1);
+	rowStart[0] = 0;
+	for (int i=0 ; i<nSamples ; i++)
+		rowStart[i+1] = rowStart[i] + K + reverseCount[i];
+	column.resize(rowStart[nSamples]);
+	P.resize(rowStart[nSamples]);
+	std::vector<int> next(rowStart.begin(), rowStart.end()-1);
+	float scale = 1.0 / (2.0 * nSamples);
+	for (int i=0 ; i<nSamples ; i++)
+		for (int k=0 ; k<K ; k++)
+		{
+			int j = neighbors[i*K+k];
+			float p = scale * conditional[i*K+k];
+			column[next[i]] = j;
+			P[next[i]++] = p;
+			column[next[j]] = i;
+			P[next[j]++] = p;
+		}
+	return true;
+}
+
+// Fills neighbors and dist2 with (approximately) the K nearest other rows of
+// each row, closest first. False if stopped before finishing.
+bool TSNE::findNeighbors(int K, std::vector<int>& neighbors, std::vector<float>& dist2)
+{
+	// The rows are renumbered in the leaf order of the first tree, so that
+	// rows close in space are mostly close in memory too, and the leaves of
+	// that tree are consecutive runs of the new numbers.
+	int leafSize = std::max(RP_LEAF_SIZE, K+1);
+	std::vector<int> order(nSamples), leafEnds;
+	for (int i=0 ; i<nSamples ; i++)
+		order[i] = i;
+	std::mt19937 generator(seed);
+	buildRPTree(&coords[0], nDimensions, &order[0], 0, nSamples, leafSize, generator, leafEnds);
+	std::vector<float> local(nSamples * nDimensions);
+	for (int a=0 ; a<nSamples ; a++)
+		std::copy(&coords[order[a]*nDimensions], &coords[(order[a]+1)*nDimensions],
+			&local[a*nDimensions]);
+	const float* x = &local[0];
+
+	neighbors.resize(nSamples * K);
+	dist2.assign(nSamples * K, std::numeric_limits<float>::max());
+	for (int i=0 ; i<nSamples ; i++)
+		std::fill(&neighbors[i*K], &neighbors[i*K] + K, i); // i ==> none yet
+
+	std::vector<int> perm(nSamples);
+	for (int t=0 ; (t<RP_TREES) && !stopRequested ; t++)
+	{
+		for (int i=0 ; i<nSamples ; i++)
+			perm[i] = i;
+		if (t > 0)
+		{
+			generator.seed(seed + t);
+			leafEnds.clear();
+			buildRPTree(x, nDimensions, &perm[0], 0, nSamples, leafSize, generator, leafEnds);
+		}
+		// Every pair in a leaf is a candidate. A row is in just one leaf of
+		// a tree, so the leaves can be done in parallel.
+		parallelFor(leafEnds.size(), getNumThreads(),
+			[&](int thread, int begin, int end)
+			{
+				std::vector<float> leafCoords;
+				for (int l=begin ; (l<end) && !stopRequested ; l++)
+				{
+					int first = (l == 0) ? 0 : leafEnds[l-1];
+					int n = leafEnds[l] - first;
+					const int* members = &perm[first];
+					// gathered, so that the n^2 distances stay in cache
+					leafCoords.resize(n * nDimensions);
+					for (int a=0 ; a<n ; a++)
+						std::copy(&x[members[a]*nDimensions], &x[(members[a]+1)*nDimensions],
+							&leafCoords[a*nDimensions]);
+					for (int a=1 ; a<n ; a++)
+						for (int b=0 ; b<a ; b++)
+						{
+							float d2 = distanceSquared(&leafCoords[0], nDimensions, a, b);
+							int i = members[a], j = members[b];
+							insertNeighbor(&dist2[i*K], &neighbors[i*K], K, d2, j);
+							insertNeighbor(&dist2[j*K], &neighbors[j*K], K, d2, i);
+						}
+				}
+			});
+	}
+
+	int fanout = std::min(K, REFINE_FANOUT);
+	for (int round=0 ; (round<REFINE_ROUNDS) && !stopRequested ; round++)
+	{
+		std::vector<int> previous(neighbors);
+		parallelFor(nSamples, getNumThreads(),
+			[&](int thread, int begin, int end)
+			{
+				std::vector<int> candidates;
+				for (int i=begin ; (i<end) && !stopRequested ; i++)
+				{
+					candidates.clear();
+					for (int k=0 ; k<fanout ; k++)
+					{
+						int j = previous[i*K+k];
+						if (j == i)
+							break;
+						for (int m=0 ; m<fanout ; m++)
+							if (previous[j*K+m] != i)
+								candidates.push_back(previous[j*K+m]);
+					}
+					std::sort(candidates.begin(), candidates.end());
+					candidates.erase(std::unique(candidates.begin(), candidates.end()),
+						candidates.end());
+					for (int c=0 ; c<candidates.size() ; c++)
+						insertNeighbor(&dist2[i*K], &neighbors[i*K], K,
+							distanceSquared(x, nDimensions, i, candidates[c]), candidates[c]);
+				}
+			});
+	}
+	if (stopRequested)
+		return false;
+
+	// back to the original row numbers: first the neighbors, then (by
+	// following the cycles of the permutation) the rows of K
+	for (int e=0 ; e<nSamples*K ; e++)
+		neighbors[e] = order[neighbors[e]];
+	std::vector<bool> moved(nSamples, false);
+	std::vector<int> heldNeighbors(K);
+	std::vector<float> heldDist2(K);
+	for (int start=0 ; start<nSamples ; start++)
+	{
+		if (moved[start])
+			continue;
+		std::copy(&neighbors[start*K], &neighbors[start*K] + K, heldNeighbors.begin());
+		std::copy(&dist2[start*K], &dist2[start*K] + K, heldDist2.begin());
+		for (int from=start ; !moved[from] ; from=order[from])
+		{
+			int to = order[from];
+			std::swap_ranges(heldNeighbors.begin(), heldNeighbors.end(), &neighbors[to*K]);
+			std::swap_ranges(heldDist2.begin(), heldDist2.end(), &dist2[to*K]);
+			moved[from] = true;
+		}
+	}
+	return true;
+}
+
+int TSNE::getEmbedding(float* xyz) const
+{
+	std::lock_guard<std::mutex> guard(publishedLock);
+	std::copy(published.begin(), published.end(), xyz);
+	return publishedIteration;
+}
+
+int TSNE::getNumThreads() // CLASS METHOD
+{
+	int n = numThreads;
+	if (n <= 0)
+		n = std::thread::hardware_concurrency();
+	return (n <= 0) ? 1 : n;
+}
+
+void TSNE::insert(int cell, int i, int depth)
+{
+	const float* y = &Y[3*i];
+	while (true)
+	{
+		Cell& c = octree[cell];
+		for (int d=0 ; d<3 ; d++)
+			c.com[d] = (c.com[d] * c.count + y[d]) / (c.count + 1);
+		c.count++;
+		if (c.child[0] < 0)
+		{
+			if (c.count == 1)
+			{
+				c.point = i;
+				return;
+			}
+			if (depth >= MAX_OCTREE_DEPTH)
+				return; // (near) duplicates share a leaf
+			// push the point already here down a level; its contribution to
+			// this cell's center of mass has already been counted
+			int old = c.point;
+			subdivide(cell);
+			const Cell& s = octree[cell];
+			int octant = 0;
+			for (int d=0 ; d<3 ; d++)
+				if (Y[3*old+d] > s.center[d])
+					octant |= (1 << d);
+			insert(s.child[octant], old, depth+1);
+		}
+		const Cell& s = octree[cell];
+		int octant = 0;
+		for (int d=0 ; d<3 ; d++)
+			if (y[d] > s.center[d])
+				octant |= (1 << d);
+		cell = s.child[octant];
+		depth++;
+	}
+}
+
+void TSNE::iterate()
+{
+	bool exaggerate = (iteration < EXAGGERATION_ITERATIONS);
+	float momentum = exaggerate ? 0.5 : 0.8;
+	float learningRate = std::max(200.0f, nSamples / EXAGGERATION);
+	computeGradient(exaggerate);
+
+	float mean[3] = { 0.0, 0.0, 0.0 };
+	for (int i=0 ; i<3*nSamples ; i++)
+	{
+		bool sameSign = ((gradient[i] > 0.0) == (update[i] > 0.0));
+		gains[i] = sameSign ? gains[i]*0.8 : gains[i]+0.2;
+		if (gains[i] < 0.01)
+			gains[i] = 0.01;
+		update[i] = momentum * update[i] - learningRate * gains[i] * gradient[i];
+		Y[i] += update[i];
+		mean[i%3] += Y[i];
+	}
+	for (int i=0 ; i<3*nSamples ; i++)
+		Y[i] -= mean[i%3] / nSamples;
+}
+
+void TSNE::publish()
+{
+	std::lock_guard<std::mutex> guard(publishedLock);
+	published = Y;
+	publishedIteration = iteration;
+}
+
+void TSNE::reduce(float** vbls, int nDimensions, int nSamplesIn,
+	int nComponents, float** result) const
+{
+	if (nSamplesIn != nSamples)
+	{
+		std::cerr << "TSNE::reduce: embedding has " << nSamples
+		          << " samples, not " << nSamplesIn << '\n';
+		return;
+	}
+	std::vector<float> xyz(3*nSamples);
+	getEmbedding(&xyz[0]);
+	for (int s=0 ; s<nSamples ; s++)
+		for (int c=0 ; c<nComponents ; c++)
+			result[s][c] = (c < 3) ? xyz[3*s+c] : 0.0;
+}
+
+void TSNE::repulsion(int i, float* force, double& sumQ) const
+{
+	const float* yi = &Y[3*i];
+	force[0] = force[1] = force[2] = 0.0;
+	// depth-first: at most 7 cells are left pending per level
+	int stack[8*MAX_OCTREE_DEPTH + 8];
+	int nStack = 0;
+	stack[nStack++] = 0;
+	while (nStack > 0)
+	{
+		const Cell& c = octree[stack[--nStack]];
+		if (c.count == 0)
+			continue;
+		float d[3] = { yi[0]-c.com[0], yi[1]-c.com[1], yi[2]-c.com[2] };
+		float d2 = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
+		bool leaf = (c.child[0] < 0);
+		if (leaf && (d2 < 1.0e-12))
+			continue; // i itself (or its duplicates): no force
+		float width = 2.0 * c.halfWidth;
+		if (leaf || (width*width < THETA*THETA*d2))
+		{
+			float q = 1.0 / (1.0 + d2);
+			float mult = c.count * q;
+			sumQ += mult;
+			mult *= q;
+			for (int k=0 ; k<3 ; k++)
+				force[k] += mult * d[k];
+		}
+		else
+			for (int k=0 ; k<8 ; k++)
+				stack[nStack++] = c.child[k];
+	}
+}
+
+void TSNE::run()
+{
+	running = true;
+	if (!haveSimilarities && (nIterations > 0))
+	{
+		if (!computeSimilarities())
+		{
+			running = false; // stopped; a later run starts over
+			return;
+		}
+		haveSimilarities = true;
+		// the rows are no longer needed
+		std::vector<float>().swap(coords);
+		publish();
+	}
+	while ((iteration < nIterations) && !stopRequested)
+	{
+		iterate();
+		iteration++;
+		if ((iteration % PUBLISH_INTERVAL) == 0)
+			publish();
+	}
+	publish();
+	running = false;
+}
+
+void TSNE::start()
+{
+	if (running)
+		return;
+	if (optimizer.joinable())
+		optimizer.join();
+	stopRequested = false;
+	running = true;
+	optimizer = std::thread(&TSNE::run, this);
+}
+
+void TSNE::stop()
+{
+	stopRequested = true;
+	if (optimizer.joinable())
+		optimizer.join();
+}
+
+void TSNE::subdivide(int cell)
+{
+	Cell parent = octree[cell];
+	float h = 0.5 * parent.halfWidth;
+	for (int k=0 ; k<8 ; k++)
+	{
+		Cell c;
+		for (int d=0 ; d<3 ; d++)
+		{
+			c.center[d] = parent.center[d] + (((k >> d) & 1) ? h : -h);
+			c.com[d] = 0.0;
+		}
+		c.halfWidth = h;
+		c.count = 0;
+		c.point = -1;
+		for (int j=0 ; j<8 ; j++)
+			c.child[j] = -1;
+		octree[cell].child[k] = octree.size();
+		octree.push_back(c);
+	}
+}
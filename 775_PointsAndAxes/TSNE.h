@@ -0,0 +1,102 @@
+// TSNE.h -- Barnes-Hut t-SNE (van der Maaten, 2014) embedding into 3D.
+//           Input similarities are computed only over each row's k nearest
+//           neighbors (found approximately with a random projection forest
+//           refined by neighbor-of-neighbor search), and the repulsive
+//           forces are approximated with an octree, so each iteration is
+//           O(N log N). Both phases are multi-threaded and both are done by
+//           run(), so constructing a TSNE is cheap. The optimization can run
+//           on a background thread, during which the current embedding can
+//           be fetched at any time so that a view can animate its progress.
+
+#ifndef TSNE_H
+#define TSNE_H
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Reducer.h"
+
+class TSNE : public Reducer
+{
+public:
+	// In following, each row is a sample; columns are dimensions
+	TSNE(float** vbls, int nDimensionsIn, int nSamplesIn,
+		double perplexityIn=30.0, int nIterationsIn=1000, unsigned int seed=1);
+	virtual ~TSNE();
+
+	virtual const char* getName() const { return "t-SNE"; }
+	// Copies the current embedding into components 0..2 (components beyond
+	// that are 0). vbls must be the rows the TSNE was constructed with; only
+	// their count is used. Call run() first for the final embedding.
+	virtual void reduce(float** vbls, int nDimensions, int nSamples,
+		int nComponents, float** result) const;
+
+	// Optimize on the calling thread
+	void run();
+	// Optimize on a background thread; stop() (or the destructor) ends it early
+	void start();
+	void stop();
+	bool isRunning() const { return running; }
+	int getIteration() const { return iteration; }
+	int getNumIterations() const { return nIterations; }
+
+	// Copies the most recently published embedding (3 floats per sample)
+	// into xyz and returns its iteration number: -1 (and the initial random
+	// embedding) until the input similarities have been computed.
+	int getEmbedding(float* xyz) const;
+
+	// 0 => use std::thread::hardware_concurrency()
+	static void setNumThreads(int n) { numThreads = n; }
+	static const int PUBLISH_INTERVAL = 10; // iterations
+
+private:
+	TSNE(const TSNE& t) {} // do not allow copies
+
+	struct Cell
+	{
+		float center[3], halfWidth;
+		float com[3];  // center of mass
+		int count;     // number of points in the cell
+		int child[8];  // -1 ==> none; all -1 ==> leaf
+		int point;     // for a leaf holding a single point
+	};
+
+	int nSamples, nDimensions;
+	double perplexity;
+	int nIterations;
+	unsigned int seed;
+	std::atomic<int> iteration;
+	std::atomic<bool> running, stopRequested;
+	std::thread optimizer;
+
+	std::vector<float> coords; // the input rows; freed once P is computed
+
+	// symmetrized input similarities in compressed sparse row form; an
+	// (i,j) pair may appear twice, once from each conditional distribution
+	std::vector<int> rowStart, column;
+	std::vector<float> P;
+	bool haveSimilarities;
+
+	std::vector<float> Y, gains, update, gradient;
+	std::vector<Cell> octree;
+	mutable std::mutex publishedLock;
+	std::vector<float> published;
+	int publishedIteration;
+
+	void buildOctree();
+	void computeGradient(bool exaggerate);
+	bool computeSimilarities();
+	bool findNeighbors(int K, std::vector<int>& neighbors, std::vector<float>& dist2);
+	void insert(int cell, int i, int depth);
+	void iterate();
+	void publish();
+	void repulsion(int i, float* force, double& sumQ) const;
+	void subdivide(int cell);
+
+	static int getNumThreads();
+	static int numThreads;
+};
+
+#endif
@@ -1,8 +1,9 @@
-
 #ifndef VARIABLE_H
 #define VARIABLE_H
 
+#include <limits>
 #include <string>
+#include <vector>
 
 class Variable
 {
@@ -10,12 +11,39 @@ public:
 	//Variable();
 	//virtual ~Variable();
 
-	int count;	
+	int count;
 	std::string name;
 	float minValue, maxValue, cardinality;
 	float mean;
 	float alpha, beta;
-	float *value;
+	float *value; // NaN where missing; NULL for categorical variables
+	int nMissing;
+
+	// Categorical variables store one code per row (an index into the
+	// sorted "categories") in code8 if there are at most 255 categories,
+	// else in code16. The largest code value marks a missing value.
+	std::vector<float> categories;
+	unsigned char* code8;
+	unsigned short* code16;
+	// If not empty, the normalized value of each category (e.g., from
+	// target encoding); otherwise it is alpha*category + beta.
+	std::vector<float> encoded;
+
+	bool isCategorical() const { return !categories.empty(); }
+	// -1 where missing
+	int getCode(int row) const
+	{
+		if (code8 != NULL)
+			return (code8[row] == 0xFF) ? -1 : code8[row];
+		return (code16[row] == 0xFFFF) ? -1 : code16[row];
+	}
+	float getValue(int row) const
+	{
+		if (value != NULL)
+			return value[row];
+		int code = getCode(row);
+		return (code < 0) ? std::numeric_limits<float>::quiet_NaN() : categories[code];
+	}
 };
 
 #endif
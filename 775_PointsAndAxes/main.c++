@@ -1,16 +1,24 @@
 // main.c++
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include <fstream>
-#include <sstream>
+#include <string>
+#include <vector>
 
 #include <GL/gl.h>
 #include <GL/freeglut.h>
 
-#include "Variable.h"
-#include "PCA.h"
-#include "Controller.h"
+#include "DataSet.h"
+#include "PCAModel.h"
+#include "ScatterPlotController.h"
 #include "AxesMV.h"
+#include "ParallelCoordsMV.h"
 #include "PointsMV.h"
+#include "ScatterPlotMatrixMV.h"
+#include "ShaderIF.h"
+
+// how often (in ms) edited shader sources are looked for with -watchShaders
+static const int SHADER_POLL_INTERVAL = 250;
 
 void initializeViewingInformation(Controller& c)
 {
@@ -44,222 +52,107 @@ void initializeViewingInformation(Controller& c)
 	ModelView::setProjection(ORTHOGONAL);
 }
 
+// Rebuilds the shader programs whose sources have been saved and swaps
+// them in; the redisplay then draws with them.
+static void pollShaders(int)
+{
+	if (ShaderIF::pollForChanges())
+		glutPostRedisplay();
+	glutTimerFunc(SHADER_POLL_INTERVAL, pollShaders, 0);
+}
+
 int main(int argc, char* argv[])
 {
-	if (argc != 2)
+	const char* modelIn = NULL; // a PCA model file to project with
+	const char* modelOut = NULL; // where to save the PCA model computed here
+	std::vector<std::string> iconFiles; // images for the icon glyphs
+	// linked shader programs are kept here (an empty name: not at all)
+	std::string shaderCache = (getenv("HOME") == NULL) ? "" :
+		std::string(getenv("HOME")) + "/.cache/775_PointsAndAxes";
+	bool watchShaders = false; // reload shaders when their sources are edited
+	DataSet data;
+	bool usage = (argc < 2);
+	for (int a=2 ; (a<argc) && !usage ; a++)
 	{
-		std::cerr << "Usage: " << std::endl;
-		return -1;
+		if ((strcmp(argv[a], "-load") == 0) && (a+1 < argc))
+			modelIn = argv[++a];
+		else if ((strcmp(argv[a], "-save") == 0) && (a+1 < argc))
+			modelOut = argv[++a];
+		else if (strcmp(argv[a], "-mixed") == 0)
+			PCA::setMixedPrecision(true);
+		else if ((strcmp(argv[a], "-missing") == 0) && (a+1 < argc))
+			data.setMissingValueSentinel(atof(argv[++a]));
+		else if (strcmp(argv[a], "-robust") == 0)
+			data.setRobustCovariance(true);
+		else if ((strcmp(argv[a], "-target") == 0) && (a+1 < argc))
+			data.setTargetEncoding(atoi(argv[++a]) - 1);
+		else if ((strcmp(argv[a], "-icon") == 0) && (a+1 < argc))
+			iconFiles.push_back(argv[++a]);
+		else if ((strcmp(argv[a], "-shaderCache") == 0) && (a+1 < argc))
+			shaderCache = argv[++a];
+		else if (strcmp(argv[a], "-watchShaders") == 0)
+			watchShaders = true;
+		else
+			usage = true;
 	}
-
-	std::ifstream infile(argv[1]);
-	
-	if (!infile.good())
+	if (usage || ((modelIn != NULL) && (modelOut != NULL)))
 	{
-		std::cerr << "Could not open" << argv[1] << "for reading." << std::endl;
+		std::cerr << "Usage: " << argv[0] << " file.okc [-save model.pca | -load model.pca] [-mixed]"
+		          << " [-missing sentinelValue] [-robust] [-target variableNumber]"
+		          << " [-icon imageFile ...] [-shaderCache directory] [-watchShaders]" << std::endl;
 		return -1;
 	}
-		
-	int N; //the number of variables
-	int R; // the number of data points
-	int nLine(0); // the number of lines already read from the file
-	
-	std::string line; //line string read from the file
 
-	int i(0),j(0);
+	if (!data.readOKC(argv[1]))
+		return -1;
 
-	Variable *mylist;
-	
-	if (infile.is_open())
+	int N = data.getNumVariables(); //the number of variables
+	int R = data.getNumRows(); // the number of data points
+	if (data.getNumCategorical() > 0)
+		std::cout << data.getNumCategorical() << " of the " << N
+		          << " variables are categorical." << std::endl;
+
+	// Either project with a stored basis (skipping the covariance and its
+	// eigen-decomposition) or compute a new one for the chosen variables.
+	std::vector<int> subset;
+	PCAModel* model = NULL;
+	if (modelIn != NULL)
 	{
-		while (std::getline(infile, line))
-		{
-			nLine++;
-			if (nLine == 1)
-			{
-				std::stringstream iss(line);
-				if (iss >> N >> R)//process initialization
-				{
-					mylist = new Variable[N];
-					for(i=0; i < N; i++)
-					{
-						mylist[i].value = new float[R];
-					}
-					continue;
-				}
-				else
-				{
-					std::cout << "Format Error!" << std::endl;
-				}
-			}
-			else if (nLine <= N+1) //read from line 2 to line N+1
-			{
-				mylist[nLine-2].count = nLine - 1;
-				mylist[nLine-2].name = line;
-
-			}
-			else if (nLine <= 2*N + 1) //read from line N+2 to line 2N+1
-			{
-				std::stringstream iss(line);
-				iss >> mylist[nLine-N-2].minValue >> mylist[nLine-N-2].maxValue >> mylist[nLine-N-2].cardinality;
-				mylist[nLine-N-2].alpha = 1/(mylist[nLine-N-2].maxValue - mylist[nLine-N-2].minValue);
-				mylist[nLine-N-2].beta = - mylist[nLine-N-2].minValue/(mylist[nLine-N-2].maxValue - mylist[nLine-N-2].minValue);
-			}
-			else //read from line 2N+2 to line 2N+R+1
-			{
-				std::stringstream iss(line);
-				for(i=0;i < N;i++)				
-				{
-					iss >> mylist[i].value[j];	
-				}
-				j++;
-			}
-		}
+		model = PCAModel::read(modelIn);
+		if ((model == NULL) || !model->findSubset(data, subset))
+			return -1;
 	}
-	
-	for (i = 0; i < N; i++)//calculate the mean of each variable
+	else
 	{
-		float sum = 0;
-		for(j = 0; j < R; j++)
-		{
-			sum = sum + mylist[i].value[j];
-		}
-		mylist[i].mean = sum/R;
+		if (!ScatterPlotController::readVariableSubset(data, subset))
+			return -1;
+		PCA* pca = data.createPCA(subset);
+		model = new PCAModel(data, subset, *pca);
+		delete pca;
+		if ((modelOut != NULL) && !model->write(modelOut))
+			return -1;
 	}
+	int varCount = subset.size();
 
-/*	for (i = 0; i < N; i++) //test output
-	{
-		std::cout << mylist[i].name << std::endl;
-		std::cout << mylist[i].minValue << "\t" << mylist[i].maxValue << "\t" << mylist[i].cardinality << std::endl;
-		std::cout << mylist[i].alpha << "\t" << mylist[i].beta << "\t" << std::endl;
-		std::cout << mylist[i].mean << std::endl;
-		for (j = 0; j < R; j++)
-		{
-			std::cout << mylist[i].value[j] << " ";
-		}
-		std::cout << "\n";
-	}*/
+	// (on the heap: R can be far too large for the stack)
+	std::vector<cryph::Point3f> pts(R);
+	std::vector<float> sps(R), sz(R), crs(R);//array used to store value
 
-	int* varInclude = NULL; 
-	int varCount;
-	std::cout << "How many variables of original data set you want to use (prefer all of them):";
-	std::cin >> varCount;
-	varInclude = new int[varCount];
-	std::cout << "\n";
-	std::cout << "Please include the variables' serial number you want to use (1 - Max), separate by space, then press enter." << std::endl;
-	std::cout << "include:";
-	for(i = 0; i < varCount; i++)
-	{
-		std::cin >> varInclude[i];
-	}
-
-	Variable* newlist = new Variable[varCount];
-	for(i = 0; i < varCount; i++)
-	{	
-		for(int w = 0; w < N; w++)
-		{
-			if(mylist[w].count == varInclude[i])
-			{
-				newlist[i].value = new float[R];
-				newlist[i].alpha = mylist[w].alpha;
-				newlist[i].beta = mylist[w].beta;
-				for(j = 0; j < R; j++)
-				{
-					newlist[i].value[j] = mylist[w].value[j];
-				}
-			}
-		}
-	}
-
-	//create a 2-dimension array to rearrange the data
-	float** vals = new float*[R];
-	for (j = 0 ; j < R ; j++)
-		vals[j] = new float[varCount];
-	
-	for (i = 0; i < varCount; i++)//fetch the data from mylist to array vlas
-	{
-		for (j = 0; j < R; j++)
-		{
-			vals[j][i] = newlist[i].alpha * newlist[i].value[j] + newlist[i].beta;
-		}
-	}
-
-/*	for (j = 0; j < R; j++)//to test the array vals
-	{
-		for (i = 0; i < N; i++)
-		{
-			std::cout << vals[j][i] << " ";
-		}
-		std::cout <<"\n";
-	}
-*/
-
-	cryph::AffPoint pts[R];
-	float sps[R], sz[R], crs[R];//array used to store value
-	
-	PCA pca(vals, N, R);
-	
-	float eigenValue;
-	float* eigenVector = new float[N];
-	
 	//print eigenValues and eigenVectors
-	for (int i = 0 ; i < 6 ; i++)
+	for (int i = 0 ; (i < 6) && (i < varCount) ; i++)
 	{
-		pca.getIthLargestEigenValueEigenVector(i, eigenValue, eigenVector);
-		std::cout << "eigenValue[" << i << "] = " << eigenValue << "; eigenVector:";
-		for (int j=0 ; j<N ; j++)
+		const double* eigenVector = model->getIthLargestEigenVector(i);
+		std::cout << "eigenValue[" << i << "] = " << model->getIthLargestEigenValue(i) << "; eigenVector:";
+		for (int j=0 ; j<varCount ; j++)
 			std::cout << " " << eigenVector[j];
 		std::cout << '\n';
 	}
 
-	//get the x, y, z values of each sample from the file 
-	float minXValue, maxXValue, minYValue, maxYValue, minZValue, maxZValue;
-	float minShape, maxShape, minColor, maxColor;
-	for (int i = 0; i < R; i++)
-	{
-		float xValue(0),yValue(0),zValue(0);
-		float shape(0), size(0), color(0);
-
-		for (int v = 0; v < 6; v++)
-		{
-			pca.getIthLargestEigenValueEigenVector(v, eigenValue, eigenVector);
-			if(v == 0)
-			{
-				for (int j = 0 ; j < N ; j++)
-					xValue = vals[i][j]*eigenVector[j]+xValue;
-			}
-			if(v == 1)
-			{
-				for (int j = 0 ; j < N ; j++)
-					yValue = vals[i][j]*eigenVector[j]+yValue;
-			}
-			if(v == 2)
-			{
-				for (int j = 0 ; j < N ; j++)
-					zValue = vals[i][j]*eigenVector[j]+zValue;
-			}
-			if(v == 3)
-			{
-				for (int j = 0 ; j < N ; j++)
-					shape = vals[i][j]*eigenVector[j]+shape;
-			}
-			if(v == 4)
-			{
-				for (int j = 0 ; j < N ; j++)
-					size = vals[i][j]*eigenVector[j]+size;
-			}
-			else
-			{
-				for (int j = 0 ; j < N ; j++)
-					color = vals[i][j]*eigenVector[j]+color;
-			}
-		}
-		pts[i] = cryph::AffPoint(xValue, yValue, zValue);
-		sps[i] = shape;
-		sz[i] = size;
-		crs[i] = color;
-	}
+	//get the x, y, z values of each sample from the file
+	model->project(data, subset, pts.data(), sps.data(), sz.data(), crs.data());
+	delete model;
 
+	float minShape, maxShape, minColor, maxColor;
 	maxShape = minShape = sps[0];
 	maxColor = minColor = crs[0];	
 	for (int i = 0; i<R; i++)
@@ -283,8 +176,11 @@ int main(int argc, char* argv[])
 
 	// One-time initialization of the glut
 	glutInit(&argc, argv);
+	ShaderIF::setProgramCacheDirectory(shaderCache);
 
-	Controller c("Scatter Plot", GLUT_DOUBLE|GLUT_DEPTH);
+	ScatterPlotController c("Scatter Plot", GLUT_DOUBLE|GLUT_DEPTH, &data);
+	if (watchShaders)
+		glutTimerFunc(SHADER_POLL_INTERVAL, pollShaders, 0);
 
 /*	AxesMV* axes = new AxesMV(minXValue, maxXValue, 0.2, 0.5,
 				  minYValue, maxYValue, 0.2, 0.5,
@@ -296,7 +192,7 @@ int main(int argc, char* argv[])
 
 	c.addModel(axes);
 	
-	PointsMV* ptsmv = new PointsMV(pts, sps, sz, crs, R, GL_POINTS);	
+	PointsMV* ptsmv = new PointsMV(pts.data(), sps.data(), sz.data(), crs.data(), R, GL_POINTS);	
 	std::cout << "The above data are the values for attributes shape, size and color respectively" << std::endl;
 	std::cout << "First colume (shape) | Second colume (size) | Third colue (color)" << std::endl;
 	std::cout << "\n";
@@ -311,24 +207,44 @@ int main(int argc, char* argv[])
 	std::cout << "According to Color(Min) and Color(Max) value, please input two proper cut-points for colors(increasing), sperate by space, then press Enter:" << std::endl;
 	std::cin >> ptsmv->cutForRed >> ptsmv->cutForGreen;
 	std::cout << "\n";
-	std::cout << "Please input three locations for vec4 pvaSet for attribute shape, size and color (must be 0 - 7):";
+	std::cout << "Attributes 0 - 2 are the shape, size and color values above; 3 - 7 are the\n"
+	          << "(normalized) values of the first five variables chosen for the projection.\n";
+	std::cout << "Please input three attributes (0 - 7) to use for shape, size and color:";
+	int useForShape, useForSize, useForColor;
 	do{
-		std::cin >> ptsmv->useForShape >> ptsmv->useForSize >> ptsmv->useForColor;
-		if(ptsmv->useForShape > 7 || ptsmv->useForSize > 7 || ptsmv->useForColor > 7)
+		std::cin >> useForShape >> useForSize >> useForColor;
+		if(useForShape > 7 || useForSize > 7 || useForColor > 7)
 		{
 			std::cout << "Locations for pvaSets can not exceed 7, please input again:";
 			continue;
 		}
 		else break;
 	}while(1);
+	ptsmv->setAttributesToUse(useForShape, useForSize, useForColor);
 
+	if (!iconFiles.empty() && !ptsmv->setIcons(iconFiles))
+		return -1;
+	ptsmv->setOriginalData(data.getVariables(), N);
+	c.setPointsMV(ptsmv, subset);
 	c.addModel(ptsmv);
 
+	ParallelCoordsMV* pcmv = new ParallelCoordsMV(data);
+	c.addModel(pcmv);
+	c.setParallelCoordsMV(pcmv);
+	ScatterPlotMatrixMV* spmmv = new ScatterPlotMatrixMV(data);
+	c.addModel(spmmv);
+	c.setScatterPlotMatrixMV(spmmv);
+
 	initializeViewingInformation(c);
 	glClearColor(1.0, 1.0, 1.0, 1.0);
 
 	std::cout << "\n";
 	std::cout << "Program runs successfully. Congratulations!" << std::endl;
+	std::cout << "Right-click on a point to print its original variable values;" << std::endl;
+	std::cout << "hovering the mouse over a point reports its data row." << std::endl;
+	std::cout << "Press 's' to project onto the principal components of a different variable subset," << std::endl;
+	std::cout << "or 'r' to switch to random projection, landmark MDS or (animated) t-SNE." << std::endl;
+	std::cout << "Press 'v' to switch to parallel coordinates or a scatter plot matrix of all the variables." << std::endl;
 	std::cout << "Hit ^C and follow the same steps if you want to change the cutpoints or test another data set." << std::endl;
 	// Off to the glut event handling loop:
 	glutMainLoop();
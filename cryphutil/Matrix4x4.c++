@@ -4,6 +4,9 @@
 
 #include <stdlib.h>
 #include <math.h>
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 #include <iomanip>
 using namespace std;
@@ -453,6 +456,194 @@ void Matrix4x4::setElementAt(int i, int j, double newValue)
 		mElem[i][j] = newValue;
 }
 
+// ---------- batch transformation kernels
+
+template <typename T>
+static inline void transformOne(const T m[4][4], T x, T y, T z,
+	T& xOut, T& yOut, T& zOut, bool perspectiveDivide)
+{
+	T d0 = m[0][0]*x + m[0][1]*y + m[0][2]*z + m[0][3];
+	T d1 = m[1][0]*x + m[1][1]*y + m[1][2]*z + m[1][3];
+	T d2 = m[2][0]*x + m[2][1]*y + m[2][2]*z + m[2][3];
+	if (perspectiveDivide)
+	{
+		T w = m[3][0]*x + m[3][1]*y + m[3][2]*z + m[3][3];
+		if (fabs(w) > BasicDistanceTol)
+		{
+			T invW = T(1) / w;
+			d0 *= invW; d1 *= invW; d2 *= invW;
+		}
+	}
+	xOut = d0; yOut = d1; zOut = d2;
+}
+
+#ifdef __SSE2__
+// 1/w where |w| > BasicDistanceTol; 1 elsewhere
+static inline __m128 safeInverse(__m128 w)
+{
+	__m128 absW = _mm_andnot_ps(_mm_set1_ps(-0.0f), w);
+	__m128 use = _mm_cmpgt_ps(absW, _mm_set1_ps(BasicDistanceTol));
+	__m128 one = _mm_set1_ps(1.0f);
+	return _mm_or_ps(_mm_and_ps(use, _mm_div_ps(one, w)), _mm_andnot_ps(use, one));
+}
+
+static inline __m128d safeInverse(__m128d w)
+{
+	__m128d absW = _mm_andnot_pd(_mm_set1_pd(-0.0), w);
+	__m128d use = _mm_cmpgt_pd(absW, _mm_set1_pd(BasicDistanceTol));
+	__m128d one = _mm_set1_pd(1.0);
+	return _mm_or_pd(_mm_and_pd(use, _mm_div_pd(one, w)), _mm_andnot_pd(use, one));
+}
+#endif
+
+#ifdef __AVX__
+static inline __m256 safeInverse(__m256 w)
+{
+	__m256 absW = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), w);
+	__m256 use = _mm256_cmp_ps(absW, _mm256_set1_ps(BasicDistanceTol), _CMP_GT_OQ);
+	__m256 one = _mm256_set1_ps(1.0f);
+	return _mm256_blendv_ps(one, _mm256_div_ps(one, w), use);
+}
+
+static inline __m256d safeInverse(__m256d w)
+{
+	__m256d absW = _mm256_andnot_pd(_mm256_set1_pd(-0.0), w);
+	__m256d use = _mm256_cmp_pd(absW, _mm256_set1_pd(BasicDistanceTol), _CMP_GT_OQ);
+	__m256d one = _mm256_set1_pd(1.0);
+	return _mm256_blendv_pd(one, _mm256_div_pd(one, w), use);
+}
+#endif
+
+// Row r of the transformation of n lanes of (x, y, z, 1): one kernel
+// body for each vector type; SET1, ADD and MUL are its intrinsics.
+#define TRANSFORM_ROW(r, px, py, pz, SET1, ADD, MUL) \
+	ADD(ADD(MUL(SET1(m[r][0]), px), MUL(SET1(m[r][1]), py)), \
+	    ADD(MUL(SET1(m[r][2]), pz), SET1(m[r][3])))
+
+#define TRANSFORM_SOA(VEC, WIDTH, LOAD, STORE, SET1, ADD, MUL) \
+	for ( ; i+WIDTH<=n ; i+=WIDTH) \
+	{ \
+		VEC px = LOAD(x+i), py = LOAD(y+i), pz = LOAD(z+i); \
+		VEC d0 = TRANSFORM_ROW(0, px, py, pz, SET1, ADD, MUL); \
+		VEC d1 = TRANSFORM_ROW(1, px, py, pz, SET1, ADD, MUL); \
+		VEC d2 = TRANSFORM_ROW(2, px, py, pz, SET1, ADD, MUL); \
+		if (perspectiveDivide) \
+		{ \
+			VEC invW = safeInverse(TRANSFORM_ROW(3, px, py, pz, SET1, ADD, MUL)); \
+			d0 = MUL(d0, invW); d1 = MUL(d1, invW); d2 = MUL(d2, invW); \
+		} \
+		STORE(xOut+i, d0); STORE(yOut+i, d1); STORE(zOut+i, d2); \
+	}
+
+void Matrix4x4::transformPoints(const float* x, const float* y, const float* z, int n,
+	float* xOut, float* yOut, float* zOut, bool perspectiveDivide) const
+{
+	float m[4][4];
+	for (int r=0 ; r<4 ; r++)
+		for (int c=0 ; c<4 ; c++)
+			m[r][c] = static_cast<float>(mElem[r][c]);
+	int i = 0;
+#ifdef __AVX__
+	TRANSFORM_SOA(__m256, 8, _mm256_loadu_ps, _mm256_storeu_ps,
+		_mm256_set1_ps, _mm256_add_ps, _mm256_mul_ps)
+#endif
+#ifdef __SSE2__
+	TRANSFORM_SOA(__m128, 4, _mm_loadu_ps, _mm_storeu_ps,
+		_mm_set1_ps, _mm_add_ps, _mm_mul_ps)
+#endif
+	for ( ; i<n ; i++)
+		transformOne(m, x[i], y[i], z[i], xOut[i], yOut[i], zOut[i], perspectiveDivide);
+}
+
+void Matrix4x4::transformPoints(const double* x, const double* y, const double* z, int n,
+	double* xOut, double* yOut, double* zOut, bool perspectiveDivide) const
+{
+	const double (*m)[4] = mElem;
+	int i = 0;
+#ifdef __AVX__
+	TRANSFORM_SOA(__m256d, 4, _mm256_loadu_pd, _mm256_storeu_pd,
+		_mm256_set1_pd, _mm256_add_pd, _mm256_mul_pd)
+#endif
+#ifdef __SSE2__
+	TRANSFORM_SOA(__m128d, 2, _mm_loadu_pd, _mm_storeu_pd,
+		_mm_set1_pd, _mm_add_pd, _mm_mul_pd)
+#endif
+	for ( ; i<n ; i++)
+		transformOne(m, x[i], y[i], z[i], xOut[i], yOut[i], zOut[i], perspectiveDivide);
+}
+
+void Matrix4x4::transformPoints(const float* xyz, int n, float* xyzOut,
+	bool perspectiveDivide) const
+{
+	float m[4][4];
+	for (int r=0 ; r<4 ; r++)
+		for (int c=0 ; c<4 ; c++)
+			m[r][c] = static_cast<float>(mElem[r][c]);
+	int i = 0;
+#ifdef __SSE2__
+	// one point per vector: the columns of m weighted by x, y and z
+	__m128 col[4];
+	for (int c=0 ; c<4 ; c++)
+		col[c] = _mm_setr_ps(m[0][c], m[1][c], m[2][c], m[3][c]);
+	for ( ; i<n ; i++)
+	{
+		const float* p = &xyz[3*i];
+		__m128 d = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(col[0], _mm_set1_ps(p[0])), _mm_mul_ps(col[1], _mm_set1_ps(p[1]))),
+			_mm_add_ps(_mm_mul_ps(col[2], _mm_set1_ps(p[2])), col[3]));
+		if (perspectiveDivide)
+			d = _mm_mul_ps(d, safeInverse(_mm_shuffle_ps(d, d, _MM_SHUFFLE(3,3,3,3))));
+		// exactly three floats, so xyzOut may be xyz
+		float* q = &xyzOut[3*i];
+		_mm_storel_pi(reinterpret_cast<__m64*>(q), d);
+		_mm_store_ss(q+2, _mm_movehl_ps(d, d));
+	}
+#endif
+	for ( ; i<n ; i++)
+		transformOne(m, xyz[3*i], xyz[3*i+1], xyz[3*i+2],
+			xyzOut[3*i], xyzOut[3*i+1], xyzOut[3*i+2], perspectiveDivide);
+}
+
+void Matrix4x4::transformPoints(const double* xyz, int n, double* xyzOut,
+	bool perspectiveDivide) const
+{
+	const double (*m)[4] = mElem;
+	int i = 0;
+#ifdef __SSE2__
+	// one point per pair of vectors: (x', y') and (z', w')
+	__m128d colXY[4], colZW[4];
+	for (int c=0 ; c<4 ; c++)
+	{
+		colXY[c] = _mm_setr_pd(m[0][c], m[1][c]);
+		colZW[c] = _mm_setr_pd(m[2][c], m[3][c]);
+	}
+	for ( ; i<n ; i++)
+	{
+		const double* p = &xyz[3*i];
+		__m128d px = _mm_set1_pd(p[0]), py = _mm_set1_pd(p[1]), pz = _mm_set1_pd(p[2]);
+		__m128d xy = _mm_add_pd(_mm_add_pd(_mm_mul_pd(colXY[0], px), _mm_mul_pd(colXY[1], py)),
+			_mm_add_pd(_mm_mul_pd(colXY[2], pz), colXY[3]));
+		__m128d zw = _mm_add_pd(_mm_add_pd(_mm_mul_pd(colZW[0], px), _mm_mul_pd(colZW[1], py)),
+			_mm_add_pd(_mm_mul_pd(colZW[2], pz), colZW[3]));
+		if (perspectiveDivide)
+		{
+			__m128d invW = safeInverse(_mm_unpackhi_pd(zw, zw));
+			xy = _mm_mul_pd(xy, invW);
+			zw = _mm_mul_pd(zw, invW);
+		}
+		double* q = &xyzOut[3*i];
+		_mm_storeu_pd(q, xy);
+		_mm_store_sd(q+2, zw);
+	}
+#endif
+	for ( ; i<n ; i++)
+		transformOne(m, xyz[3*i], xyz[3*i+1], xyz[3*i+2],
+			xyzOut[3*i], xyzOut[3*i+1], xyzOut[3*i+2], perspectiveDivide);
+}
+
+#undef TRANSFORM_SOA
+#undef TRANSFORM_ROW
+
 Matrix4x4 Matrix4x4::translation(const AffVector& translation)
 {
 	Matrix4x4 M;
@@ -104,6 +104,22 @@ public:
 
 	void setElementAt(int i, int j, double newValue);
 
+	// Batch transformations of the n points (x[i], y[i], z[i], 1), given
+	// either as separate ("SoA") x, y and z arrays or interleaved as
+	// xyz[3*i..3*i+2]. Outputs may be the same arrays as the inputs. If
+	// perspectiveDivide, results are divided by w (where |w| is not tiny,
+	// as in operator*(const AffPoint&)); otherwise w is ignored. The float
+	// versions compute in float. SSE2 (and AVX, if compiled with it)
+	// kernels are used when available.
+	void transformPoints(const float* x, const float* y, const float* z, int n,
+		float* xOut, float* yOut, float* zOut, bool perspectiveDivide=false) const;
+	void transformPoints(const double* x, const double* y, const double* z, int n,
+		double* xOut, double* yOut, double* zOut, bool perspectiveDivide=false) const;
+	void transformPoints(const float* xyz, int n, float* xyzOut,
+		bool perspectiveDivide=false) const;
+	void transformPoints(const double* xyz, int n, double* xyzOut,
+		bool perspectiveDivide=false) const;
+
 
     // ---------- Global constants
 
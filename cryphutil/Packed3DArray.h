@@ -25,21 +25,49 @@
 #define PACKED3DARRAY_H
 
 #include <iostream>
+#include <new>
 
 namespace cryph
 {
 
+// A view of "size" consecutive elements of a Packed3DArray; valid only as
+// long as the array's storage is.
+template <typename T>
+struct Packed3DArraySpan
+{
+	T*	data;
+	int	size;
+
+	T&	operator[](int i) const { return data[i]; }
+	T*	begin() const { return data; }
+	T*	end() const { return data + size; }
+};
+
 template <typename T>
 class Packed3DArray
 {
 public:
+	// Called to release an adopted buffer (see below)
+	typedef void (*Releaser)(T* data, void* context);
+
 	// --------- basic constructors
 	Packed3DArray(int dim1=2, int dim2=2, int dim3=3);
 	Packed3DArray(const Packed3DArray<T>& t3da);
+	Packed3DArray(Packed3DArray<T>&& t3da);
+	// Adopt dim1*dim2*dim3 elements of externally allocated memory (e.g.,
+	// decoder output or an mmap'd file) without copying. When the array
+	// is destroyed, "release" is called with the data and "context"; if
+	// it is NULL the memory still belongs to the caller and must outlive
+	// the array. (adoptNewArray is a Releaser for memory from new T[].)
+	Packed3DArray(T* data, int dim1, int dim2, int dim3,
+		Releaser release=NULL, void* context=NULL);
 
 	// --------- destructor
 	virtual ~Packed3DArray();
 
+	Packed3DArray<T>& operator=(const Packed3DArray<T>& rhs);
+	Packed3DArray<T>& operator=(Packed3DArray<T>&& rhs);
+
 	// ---------- General Methods
 	const T*	getData() const { return mData; }
 	T			getDataElement(int i1, int i2, int i3) const;
@@ -51,18 +79,44 @@ public:
 	int			getTotalNumberElements() const;
 	void		setDataElement(int i1, int i2, int i3, const T& elem);
 
+	// Unchecked access, for inner loops over known-good indices
+	T&			operator()(int i1, int i2, int i3)
+					{ return mData[(i1*mDim2 + i2)*mDim3 + i3]; }
+	const T&	operator()(int i1, int i2, int i3) const
+					{ return mData[(i1*mDim2 + i2)*mDim3 + i3]; }
+	// the dim2*dim3 elements with first index i1 (e.g., an image row)
+	Packed3DArraySpan<T>		getPlane(int i1)
+		{ Packed3DArraySpan<T> s = { &mData[i1*mDim2*mDim3], mDim2*mDim3 }; return s; }
+	Packed3DArraySpan<const T>	getPlane(int i1) const
+		{ Packed3DArraySpan<const T> s = { &mData[i1*mDim2*mDim3], mDim2*mDim3 }; return s; }
+	// the dim3 elements at (i1, i2) (e.g., the channels of a pixel)
+	Packed3DArraySpan<T>		getRow(int i1, int i2)
+		{ Packed3DArraySpan<T> s = { &(*this)(i1, i2, 0), mDim3 }; return s; }
+	Packed3DArraySpan<const T>	getRow(int i1, int i2) const
+		{ Packed3DArraySpan<const T> s = { &(*this)(i1, i2, 0), mDim3 }; return s; }
+
 	// --------- Class methods
+	static void	adoptNewArray(T* data, void* context) { delete [] data; }
 	static void	setErrorReporting(bool r);
 	static void	setOutOfBoundsValue(T defaultValue);
 
+	// storage allocated by the array itself starts on a multiple of this
+	static const int ALIGNMENT = 64;
+
 private:
 
 	int		getOffset(const char* routine, int i1, int i2, int i3) const;
+	void	allocate(int size);
+	void	release();
 
 	T*		mData;
 	int		mDim1;
 	int		mDim2;
 	int		mDim3;
+	// how mData is freed: allocated here (mOwned) or by "mRelease"
+	bool		mOwned;
+	Releaser	mRelease;
+	void*		mReleaseContext;
 
 	static	bool	sReportErrors;
 	static	T		sOutOfBoundsValue;
@@ -76,7 +130,8 @@ T		Packed3DArray<T>::sOutOfBoundsValue;
 
 template <typename T>
 Packed3DArray<T>::Packed3DArray(int dim1, int dim2, int dim3) :
-		mData(NULL), mDim1(dim1), mDim2(dim2), mDim3(dim3)
+		mData(NULL), mDim1(dim1), mDim2(dim2), mDim3(dim3),
+		mOwned(false), mRelease(NULL), mReleaseContext(NULL)
 {
 	if ( (dim1 < 1) || (dim2 < 1) || (dim3 < 1) )
 	{
@@ -86,30 +141,107 @@ Packed3DArray<T>::Packed3DArray(int dim1, int dim2, int dim3) :
 			     << dim1 << ", " << dim2 << ", " << dim3 << ')' << std::endl;
 	}
 	else
-		mData = new T[dim1*dim2*dim3];
+		allocate(dim1*dim2*dim3);
 }
 
 template <typename T>
 Packed3DArray<T>::Packed3DArray(const Packed3DArray<T>& t3da) :
-		mData(NULL), mDim1(t3da.mDim1), mDim2(t3da.mDim2), mDim3(t3da.mDim3)
+		mData(NULL), mDim1(t3da.mDim1), mDim2(t3da.mDim2), mDim3(t3da.mDim3),
+		mOwned(false), mRelease(NULL), mReleaseContext(NULL)
 {
 	int		size = mDim1 * mDim2 * mDim3;
-	mData = new T[size];
+	if (size > 0)
+		allocate(size);
 	for (int i=0 ; i<size ; i++)
 		mData[i] = t3da.mData[i];
 }
 
+template <typename T>
+Packed3DArray<T>::Packed3DArray(Packed3DArray<T>&& t3da) :
+		mData(t3da.mData), mDim1(t3da.mDim1), mDim2(t3da.mDim2), mDim3(t3da.mDim3),
+		mOwned(t3da.mOwned), mRelease(t3da.mRelease), mReleaseContext(t3da.mReleaseContext)
+{
+	t3da.mData = NULL;
+	t3da.mDim1 = t3da.mDim2 = t3da.mDim3 = 0;
+	t3da.mOwned = false;
+	t3da.mRelease = NULL;
+}
+
+template <typename T>
+Packed3DArray<T>::Packed3DArray(T* data, int dim1, int dim2, int dim3,
+		Releaser release, void* context) :
+		mData(data), mDim1(dim1), mDim2(dim2), mDim3(dim3),
+		mOwned(false), mRelease(release), mReleaseContext(context)
+{
+}
+
 template <typename T>
 Packed3DArray<T>::~Packed3DArray()
+{
+	release();
+}
+
+template <typename T>
+Packed3DArray<T>& Packed3DArray<T>::operator=(const Packed3DArray<T>& rhs)
+{
+	if (this != &rhs)
+	{
+		Packed3DArray<T> copy(rhs);
+		*this = static_cast<Packed3DArray<T>&&>(copy);
+	}
+	return *this;
+}
+
+template <typename T>
+Packed3DArray<T>& Packed3DArray<T>::operator=(Packed3DArray<T>&& rhs)
+{
+	if (this != &rhs)
+	{
+		release();
+		mData = rhs.mData;
+		mDim1 = rhs.mDim1; mDim2 = rhs.mDim2; mDim3 = rhs.mDim3;
+		mOwned = rhs.mOwned;
+		mRelease = rhs.mRelease;
+		mReleaseContext = rhs.mReleaseContext;
+		rhs.mData = NULL;
+		rhs.mDim1 = rhs.mDim2 = rhs.mDim3 = 0;
+		rhs.mOwned = false;
+		rhs.mRelease = NULL;
+	}
+	return *this;
+}
+
+template <typename T>
+void Packed3DArray<T>::allocate(int size)
+{
+	void* mem = ::operator new(size*sizeof(T), std::align_val_t(ALIGNMENT));
+	mData = static_cast<T*>(mem);
+	for (int i=0 ; i<size ; i++)
+		new (&mData[i]) T;
+	mOwned = true;
+}
+
+template <typename T>
+void Packed3DArray<T>::release()
 {
 	if (mData != NULL)
 	{
-		delete [] mData;
+		if (mOwned)
+		{
+			int size = mDim1 * mDim2 * mDim3;
+			for (int i=0 ; i<size ; i++)
+				mData[i].~T();
+			::operator delete(static_cast<void*>(mData), std::align_val_t(ALIGNMENT));
+		}
+		else if (mRelease != NULL)
+			mRelease(mData, mReleaseContext);
 		mData = NULL;
 		mDim1 = 0;
 		mDim2 = 0;
 		mDim3 = 0;
 	}
+	mOwned = false;
+	mRelease = NULL;
 }
 
 template <typename T>
@@ -0,0 +1,100 @@
+// Point3.h -- Plain 3D points and vectors for bulk data. Unlike AffPoint and
+//             AffVector, these have no virtual functions and no constructor
+//             work: an array of Point3f is exactly 3*n packed floats, so it
+//             can be memcpy'd, mapped from a file or handed straight to
+//             glBufferData. They convert to and from AffPoint/AffVector
+//             for the geometric operations those provide.
+
+#ifndef POINT3_H
+#define POINT3_H
+
+#include <type_traits>
+
+#include "AffPoint.h"
+#include "AffVector.h"
+
+namespace cryph
+{
+
+template <typename T>
+struct Vector3
+{
+	T dx, dy, dz;
+
+	Vector3() = default; // components uninitialized, as for a T
+	constexpr Vector3(T Dx, T Dy, T Dz) : dx(Dx), dy(Dy), dz(Dz) { }
+	template <typename U>
+	constexpr explicit Vector3(const Vector3<U>& v) : dx(v.dx), dy(v.dy), dz(v.dz) { }
+	explicit Vector3(const AffVector& v) : dx(v.dx), dy(v.dy), dz(v.dz) { }
+	operator AffVector() const { return AffVector(dx, dy, dz); }
+
+	// see the indexing constants DX, DY and DZ in AffVector.h
+	constexpr T operator[](int index) const
+		{ return (index == DX) ? dx : ((index == DY) ? dy : dz); }
+	constexpr T& operator[](int index)
+		{ return (index == DX) ? dx : ((index == DY) ? dy : dz); }
+
+	constexpr Vector3 operator+(const Vector3& v2) const
+		{ return Vector3(dx + v2.dx, dy + v2.dy, dz + v2.dz); }
+	constexpr Vector3 operator-(const Vector3& v2) const
+		{ return Vector3(dx - v2.dx, dy - v2.dy, dz - v2.dz); }
+	constexpr Vector3 operator-() const { return Vector3(-dx, -dy, -dz); }
+	constexpr Vector3 operator*(T f) const { return Vector3(f*dx, f*dy, f*dz); }
+	constexpr Vector3 operator/(T f) const { return Vector3(dx/f, dy/f, dz/f); }
+
+	constexpr Vector3 cross(const Vector3& rhs) const
+		{ return Vector3(dy*rhs.dz - dz*rhs.dy, dz*rhs.dx - dx*rhs.dz, dx*rhs.dy - dy*rhs.dx); }
+	constexpr T dot(const Vector3& rhs) const { return dx*rhs.dx + dy*rhs.dy + dz*rhs.dz; }
+	constexpr T lengthSquared() const { return dot(*this); }
+};
+
+template <typename T>
+struct Point3
+{
+	T x, y, z;
+
+	Point3() = default; // coordinates uninitialized, as for a T
+	constexpr Point3(T xx, T yy, T zz) : x(xx), y(yy), z(zz) { }
+	template <typename U>
+	constexpr explicit Point3(const Point3<U>& p) : x(p.x), y(p.y), z(p.z) { }
+	explicit Point3(const AffPoint& p) : x(p.x), y(p.y), z(p.z) { }
+	operator AffPoint() const { return AffPoint(x, y, z); }
+
+	// see the indexing constants X, Y and Z in AffPoint.h
+	constexpr T operator[](int index) const
+		{ return (index == X) ? x : ((index == Y) ? y : z); }
+	constexpr T& operator[](int index)
+		{ return (index == X) ? x : ((index == Y) ? y : z); }
+
+	constexpr Point3 operator+(const Vector3<T>& v2) const
+		{ return Point3(x + v2.dx, y + v2.dy, z + v2.dz); }
+	constexpr Point3 operator-(const Vector3<T>& v2) const
+		{ return Point3(x - v2.dx, y - v2.dy, z - v2.dz); }
+	constexpr Vector3<T> operator-(const Point3& p2) const
+		{ return Vector3<T>(x - p2.x, y - p2.y, z - p2.z); }
+
+	constexpr T distanceSquaredTo(const Point3& p) const { return (*this - p).lengthSquared(); }
+	// the affine combination (1-t)*this + t*p
+	constexpr Point3 lerp(const Point3& p, T t) const
+		{ return Point3(x + t*(p.x - x), y + t*(p.y - y), z + t*(p.z - z)); }
+};
+
+template <typename T>
+constexpr Vector3<T> operator*(T f, const Vector3<T>& v) { return v * f; }
+
+typedef Point3<float> Point3f;
+typedef Point3<double> Point3d;
+typedef Vector3<float> Vector3f;
+typedef Vector3<double> Vector3d;
+
+static_assert(std::is_trivially_copyable<Point3f>::value && std::is_standard_layout<Point3f>::value &&
+	(sizeof(Point3f) == 3*sizeof(float)), "Point3f must be three packed floats");
+static_assert(std::is_trivially_copyable<Point3d>::value && std::is_standard_layout<Point3d>::value &&
+	(sizeof(Point3d) == 3*sizeof(double)), "Point3d must be three packed doubles");
+static_assert(std::is_trivially_copyable<Vector3f>::value && std::is_standard_layout<Vector3f>::value &&
+	(sizeof(Vector3f) == 3*sizeof(float)), "Vector3f must be three packed floats");
+static_assert(std::is_trivially_copyable<Vector3d>::value && std::is_standard_layout<Vector3d>::value &&
+	(sizeof(Vector3d) == 3*sizeof(double)), "Vector3d must be three packed doubles");
+}
+
+#endif
@@ -285,6 +285,38 @@ int CFont::getHeightForTexture(int textureWidth, int charWidth, int charHeight)
 	return nextPowerOfTwo;
 }
 
+int CFont::layOut(const char *text, std::vector<GLfloat>& xy, std::vector<GLfloat>& uv) const
+{
+	float baseX = 0.0f;
+	float baseY = 0.0f;
+	int nQuads = 0;
+	for (const char* c = text; *c != '\0'; ++c)
+	{
+		if (*c == ' ')
+		{
+			// Simple hack to generate spaces, could be handled better though...
+			baseX += mCharacterData['i'].screenWidth;
+			continue;
+		}
+		// Build a quad (two triangles) for the character. Characters not in
+		// the texture (see the constructor) have no texture coordinates.
+		const CCharacterData &data = mCharacterData[static_cast<unsigned char>(*c)];
+		if (!data.isWanted)
+			continue;
+
+		float x = baseX + data.xOffset;
+		float y = baseY - data.yOffset;
+		GLfloat corners[8] = { x, y - data.byteHeight, x, y,
+			x + data.byteWidth, y - data.byteHeight, x + data.byteWidth, y };
+		xy.insert(xy.end(), corners, corners + 8);
+		uv.insert(uv.end(), data.texCoords, data.texCoords + 8);
+
+		baseX += data.screenWidth;
+		nQuads++;
+	}
+	return nQuads;
+}
+
 void CFont::show(int charCode)
 {
 	std::cout << '[';
@@ -57,6 +57,11 @@ public:
 	CCharacterData *mCharacterData;
 
 	static CFont* getFont(const std::string &fontFilename);
+
+	// Appends to xy and uv the four (x, y) font-space corners and texture
+	// coordinates of each non-blank character of "text", laid out left to
+	// right from (0, 0), and returns how many such quads there were.
+	int layOut(const char *text, std::vector<GLfloat>& xy, std::vector<GLfloat>& uv) const;
 private:
 	CFont(FILE* fontFile);
 	CFont(const CFont& cf) {}
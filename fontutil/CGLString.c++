@@ -21,6 +21,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <iostream>
+#include <vector>
 
 #include "CGLString.h"
 #include "CFont.h"
@@ -80,47 +81,12 @@ void CGLString::buildString()
 	numIndices = 6 * mNumberOfQuads;
 	mIndices = new GLbyte[numIndices];
 	
-	float baseX = 0.0f;
-	float baseY = 0.0f;
-	float x = 0.0f;
-	float y;
-	
 	// Set up vertex data...
-	int length = strlen(mText);
-	int vertIndex = 0, texIndex = 0;
-	for (int i = 0; i < length; ++i)
+	std::vector<GLfloat> xy, uv;
+	if (mFont->layOut(mText, xy, uv) > 0)
 	{
-		if (mText[i] == ' ')
-		{
-			// Simple hack to generate spaces, could be handled better though...
-			baseX += mFont->mCharacterData['i'].screenWidth;
-		}
-		else
-		{
-			// Build a quad (two triangles) for the character
-			CCharacterData &data = mFont->mCharacterData[mText[i]];
-
-			x = baseX + data.xOffset;
-			y = baseY - data.yOffset;
-
-			mVertices[vertIndex++] = x;
-			mVertices[vertIndex++] = y - data.byteHeight;
-			mVertices[vertIndex++] = x;
-			mVertices[vertIndex++] = y;
-			
-			x += data.byteWidth;
-			
-			mVertices[vertIndex++] = x;
-			mVertices[vertIndex++] = y - data.byteHeight;
-			mVertices[vertIndex++] = x;
-			mVertices[vertIndex++] = y;
-			
-			memcpy(&mUVs[texIndex], data.texCoords, sizeof(float) * 8);
-			
-			texIndex += 8;
-            
-            baseX += data.screenWidth;
-		}
+		memcpy(mVertices, &xy[0], num2DCoords * sizeof(GLfloat));
+		memcpy(mUVs, &uv[0], num2DCoords * sizeof(GLfloat));
 	}
 	
 	// And now set up an array of index data
@@ -168,6 +134,26 @@ void CGLString::linearMap(double fromMin, double fromMax, double toMin, double t
 	trans = toMin - scale*fromMin;
 }
 void CGLString::makeVerticesForRendering()
+{
+	orthonormalize(uDir, vDir, vertexCoordsDimension);
+	int loc = 0;
+	for (int i=0 ; i<num2DCoords ; i+=2)
+	{
+		double uc = aUDir*mVertices[i] + bUDir;
+		double vc = aVDir*mVertices[i+1] + bVDir;
+		cryph::AffPoint p = origin + uc*uDir + vc*vDir;
+		mVerticesForRender[loc++] = p[0];
+		mVerticesForRender[loc++] = p[1];
+		if (vertexCoordsDimension == 3)
+			mVerticesForRender[loc++] = p[2];
+	}
+	renderingParametersModified = false;
+}
+
+// Makes uDir a unit vector and vDir a unit vector perpendicular to it in the
+// plane of the two, choosing sensible defaults for degenerate directions.
+void CGLString::orthonormalize(cryph::AffVector& uDir, cryph::AffVector& vDir,
+							   int dim) // CLASS METHOD
 {
 	if (uDir.normalize() < BasicDistanceTol)
 	{
@@ -180,7 +166,7 @@ void CGLString::makeVerticesForRendering()
 		uDir.decompose(vDir, par, perp);
 		if (perp.normalizeToCopy(vDir) < BasicDistanceTol)
 		{
-			if (vertexCoordsDimension == 2)
+			if (dim == 2)
 				vDir = cryph::AffVector::zu.cross(uDir);
 			else
 			{
@@ -189,18 +175,6 @@ void CGLString::makeVerticesForRendering()
 			}
 		}
 	}
-	int loc = 0;
-	for (int i=0 ; i<num2DCoords ; i+=2)
-	{
-		double uc = aUDir*mVertices[i] + bUDir;
-		double vc = aVDir*mVertices[i+1] + bVDir;
-		cryph::AffPoint p = origin + uc*uDir + vc*vDir;
-		mVerticesForRender[loc++] = p[0];
-		mVerticesForRender[loc++] = p[1];
-		if (vertexCoordsDimension == 3)
-			mVerticesForRender[loc++] = p[2];
-	}
-	renderingParametersModified = false;
 }
 
 void CGLString::render(int pvaLoc_mcPos, int pvaLoc_texCoords, int ppuLoc_texMap)
@@ -73,10 +73,13 @@ private:
 	void makeVerticesForRendering();
 	void sendBufferDataToGPU(int pvaLoc_mcPos, int pvaLoc_texCoords);
 
+	static void orthonormalize(cryph::AffVector& uDir, cryph::AffVector& vDir, int dim);
 	static void linearMap(double fromMin, double fromMax, double toMin, double toMax,
 						  double& scale, double& trans);
 
 	GLuint vao, vboVertexCoords, vboTexCoords;
+
+	friend class CGLTextBatch;
 };
 
 #endif
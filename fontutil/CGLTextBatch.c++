@@ -0,0 +1,155 @@
+// CGLTextBatch.c++ -- many strings in one font drawn with one call
+
+#include <iostream>
+
+#include "CGLTextBatch.h"
+#include "CGLString.h"
+#include "CFont.h"
+
+CGLTextBatch::CGLTextBatch(const CFont *font, int dim) :
+	mFont(font), vertexCoordsDimension(dim), nQuads(0), modified(false),
+	vao(0), vbo(0), ebo(0), vboQuads(0), eboQuads(0),
+	pvaLoc_mcPosInVAO(-1), pvaLoc_texCoordsInVAO(-1)
+{
+	if ((vertexCoordsDimension < 2) || (vertexCoordsDimension > 3))
+		vertexCoordsDimension = 2;
+}
+
+CGLTextBatch::~CGLTextBatch()
+{
+	if (vao > 0)
+	{
+		glDeleteBuffers(1, &vbo);
+		glDeleteBuffers(1, &ebo);
+		glDeleteVertexArrays(1, &vao);
+	}
+}
+
+void CGLTextBatch::add(const char *text, const cryph::AffPoint& origin, double height,
+	const cryph::AffVector& uDir, const cryph::AffVector& vDir)
+{
+	std::vector<GLfloat> xy, uv;
+	int n = mFont->layOut(text, xy, uv);
+	if (n == 0)
+		return;
+	// bounding box as CGLString::getBoundingBox determines it
+	GLfloat xmin = xy[0], ymin = xy[1], ymax = xy[xy.size() - 1];
+	if (ymax <= ymin)
+		return;
+	// the same (aspect-preserving) scaling CGLString::setStringDimensions
+	// uses when given only a height
+	double a = height / (ymax - ymin);
+	addQuads(&xy[0], &uv[0], n, origin, uDir, vDir, a, -a*xmin, a, -a*ymin);
+}
+
+void CGLTextBatch::add(const CGLString& str)
+{
+	if (str.mFont != mFont)
+	{
+		std::cerr << "CGLTextBatch::add: string \"" << str.mText << "\" uses a different font\n";
+		return;
+	}
+	addQuads(str.mVertices, str.mUVs, str.mNumberOfQuads, str.origin, str.uDir, str.vDir,
+		str.aUDir, str.bUDir, str.aVDir, str.bVDir);
+}
+
+void CGLTextBatch::addQuads(const GLfloat *xy, const GLfloat *uv, int n,
+	const cryph::AffPoint& origin, cryph::AffVector uDir, cryph::AffVector vDir,
+	double aUDir, double bUDir, double aVDir, double bVDir)
+{
+	CGLString::orthonormalize(uDir, vDir, vertexCoordsDimension);
+	vertices.reserve(vertices.size() + 4*n*(vertexCoordsDimension + 2));
+	for (int i=0 ; i<8*n ; i+=2)
+	{
+		double uc = aUDir*xy[i] + bUDir;
+		double vc = aVDir*xy[i+1] + bVDir;
+		vertices.push_back(origin.x + uc*uDir.dx + vc*vDir.dx);
+		vertices.push_back(origin.y + uc*uDir.dy + vc*vDir.dy);
+		if (vertexCoordsDimension == 3)
+			vertices.push_back(origin.z + uc*uDir.dz + vc*vDir.dz);
+		vertices.push_back(uv[i]);
+		vertices.push_back(uv[i+1]);
+	}
+	nQuads += n;
+	modified = true;
+}
+
+void CGLTextBatch::clear()
+{
+	vertices.clear();
+	nQuads = 0;
+	modified = true;
+}
+
+void CGLTextBatch::defineVertexAttributes(int pvaLoc_mcPos, int pvaLoc_texCoords)
+{
+	if (pvaLoc_mcPosInVAO >= 0)
+		glDisableVertexAttribArray(pvaLoc_mcPosInVAO);
+	if (pvaLoc_texCoordsInVAO >= 0)
+		glDisableVertexAttribArray(pvaLoc_texCoordsInVAO);
+
+	GLsizei stride = (vertexCoordsDimension + 2) * sizeof(GLfloat);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glEnableVertexAttribArray(pvaLoc_mcPos);
+	glVertexAttribPointer(pvaLoc_mcPos, vertexCoordsDimension, GL_FLOAT, GL_FALSE, stride, 0);
+	glEnableVertexAttribArray(pvaLoc_texCoords);
+	glVertexAttribPointer(pvaLoc_texCoords, 2, GL_FLOAT, GL_FALSE, stride,
+		reinterpret_cast<const void*>(vertexCoordsDimension * sizeof(GLfloat)));
+	pvaLoc_mcPosInVAO = pvaLoc_mcPos;
+	pvaLoc_texCoordsInVAO = pvaLoc_texCoords;
+}
+
+// Every batch draws its quads with the same two triangles per quad, so the
+// indices only need to be regenerated when the batch outgrows them.
+void CGLTextBatch::growIndexBuffer()
+{
+	eboQuads = (2*eboQuads > nQuads) ? 2*eboQuads : nQuads;
+	std::vector<GLuint> indices(6*eboQuads);
+	for (int i=0 ; i<eboQuads ; i++)
+	{
+		GLuint* quad = &indices[6*i];
+		quad[0] = 4*i + 0; quad[1] = 4*i + 1; quad[2] = 4*i + 2;
+		quad[3] = 4*i + 2; quad[4] = 4*i + 1; quad[5] = 4*i + 3;
+	}
+	// the binding is recorded in the (bound) vao
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size()*sizeof(GLuint), &indices[0],
+		GL_STATIC_DRAW);
+}
+
+void CGLTextBatch::render(int pvaLoc_mcPos, int pvaLoc_texCoords, int ppuLoc_texMap)
+{
+	if (nQuads == 0)
+		return;
+
+	if (vao == 0)
+	{
+		glGenVertexArrays(1, &vao);
+		glGenBuffers(1, &vbo);
+		glGenBuffers(1, &ebo);
+	}
+	glBindVertexArray(vao);
+	if (nQuads > eboQuads)
+		growIndexBuffer();
+	if (modified)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		if (nQuads > vboQuads)
+			vboQuads = (2*vboQuads > nQuads) ? 2*vboQuads : nQuads;
+		// Orphan the old storage so that the driver need not wait for draws
+		// still reading it before accepting the new vertices.
+		glBufferData(GL_ARRAY_BUFFER,
+			4*vboQuads*(vertexCoordsDimension + 2)*sizeof(GLfloat), NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size()*sizeof(GLfloat), &vertices[0]);
+		modified = false;
+	}
+	if ((pvaLoc_mcPos != pvaLoc_mcPosInVAO) || (pvaLoc_texCoords != pvaLoc_texCoordsInVAO))
+		defineVertexAttributes(pvaLoc_mcPos, pvaLoc_texCoords);
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glBindTexture(GL_TEXTURE_2D, mFont->mTexId);
+	glUniform1i(ppuLoc_texMap, 0);
+	glDrawElements(GL_TRIANGLES, 6*nQuads, GL_UNSIGNED_INT, 0);
+	glDisable(GL_BLEND);
+}
@@ -0,0 +1,68 @@
+// CGLTextBatch.h -- Collects many strings in one font into a single streaming
+//                   vertex buffer and draws them all with one call. Adding a
+//                   string creates no GL objects, so labelling every axis tick
+//                   or thousands of points is affordable.
+//
+// Quick synopsis of use:
+//    CGLTextBatch labels(font, 3);
+//    labels.add("label", origin, height); // ... for each label
+//    labels.render(pvaLoc_mcPos, pvaLoc_texCoords, ppuLoc_texMap);
+//
+// Strings stay in the batch, and are drawn by each render, until clear() is
+// called. The vertex buffer is sent again only when strings have been added
+// since the last render.
+
+#ifndef CGLTEXTBATCH_H
+#define CGLTEXTBATCH_H
+
+#include <vector>
+#include <GL/gl.h>
+
+#include "AffPoint.h"
+#include "AffVector.h"
+
+class CFont;
+class CGLString;
+
+class CGLTextBatch
+{
+public:
+	CGLTextBatch(const CFont *font, int dim=2);
+	~CGLTextBatch();
+
+	// Adds "text" scaled to be "height" tall, running along uDir with its top
+	// toward vDir and the lower left corner of its box at "origin". All z
+	// coordinates/components are ignored when dim==2.
+	void add(const char *text, const cryph::AffPoint& origin, double height,
+		const cryph::AffVector& uDir=cryph::AffVector::xu,
+		const cryph::AffVector& vDir=cryph::AffVector::yu);
+	// Adds "str" (which must use this batch's font) where it would render itself
+	void add(const CGLString& str);
+	void clear();
+
+	int getNumberOfCharacters() const { return nQuads; }
+
+	// Blending is enabled for the draw and disabled again afterwards.
+	void render(int pvaLoc_mcPos, int pvaLoc_texCoords, int ppuLoc_texMap);
+
+private:
+	CGLTextBatch(const CGLTextBatch& b) {} // owns GL objects; do not copy
+
+	void addQuads(const GLfloat *xy, const GLfloat *uv, int n,
+		const cryph::AffPoint& origin, cryph::AffVector uDir, cryph::AffVector vDir,
+		double aUDir, double bUDir, double aVDir, double bVDir);
+	void defineVertexAttributes(int pvaLoc_mcPos, int pvaLoc_texCoords);
+	void growIndexBuffer();
+
+	const CFont *mFont;
+	int vertexCoordsDimension;
+	std::vector<GLfloat> vertices; // per vertex: position, then texture coordinates
+	int nQuads;
+	bool modified; // "vertices" changed since last sent to vbo
+
+	GLuint vao, vbo, ebo;
+	int vboQuads, eboQuads; // number of quads each has room for
+	int pvaLoc_mcPosInVAO, pvaLoc_texCoordsInVAO;
+};
+
+#endif
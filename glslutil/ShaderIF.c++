@@ -1,14 +1,99 @@
 // ShaderIF.c++: Basic interface to read, compile, and link GLSL Shader programs
 
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
 #include <iostream>
 #include <fstream>
+#include <set>
+#include <sstream>
 #include <string>
 #include <stdexcept>
+#include <algorithm>
 
 #include "ShaderIF.h"
 
+std::string ShaderIF::programCacheDirectory = "";
+
+// Hot reloading: the instances with a reload callback, and (once polling
+// has begun) the inotify watches on their source directories.
+static std::vector<ShaderIF*> reloadable;
+static int inotifyFD = -1;
+static std::map<std::string, int> watchByDirectory;
+static std::map<int, std::string> directoryByWatch;
+static int parallelCompile = -1; // GL_KHR_parallel_shader_compile; -1: not yet known
+
+// Splits "fName" into the directory inotify watches and the name within it
+static void splitPath(const std::string& fName, std::string& dir, std::string& base)
+{
+	size_t slash = fName.rfind('/');
+	if (slash == std::string::npos)
+	{
+		dir = ".";
+		base = fName;
+	}
+	else
+	{
+		dir = (slash == 0) ? "/" : fName.substr(0, slash);
+		base = fName.substr(slash + 1);
+	}
+}
+
+// 64-bit FNV-1a, continuing from "hash"
+static unsigned long long hashBytes(const void* bytes, size_t n,
+	unsigned long long hash=14695981039346656037ULL)
+{
+	const unsigned char* b = static_cast<const unsigned char*>(bytes);
+	for (size_t i=0 ; i<n ; i++)
+	{
+		hash ^= b[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static unsigned long long hashString(const char* s, unsigned long long hash)
+{
+	if (s == NULL)
+		s = "";
+	return hashBytes(s, strlen(s) + 1, hash); // the NUL separates strings
+}
+
+// Puts "defines" just after the #version line (which must precede them),
+// then restores the line numbering so that compiler messages still refer
+// to the lines of the file.
+static void insertDefines(std::string& source, const std::string& defines)
+{
+	size_t at = 0;
+	size_t version = source.find("#version");
+	if (version != std::string::npos)
+	{
+		at = source.find('\n', version);
+		if (at == std::string::npos)
+		{
+			source += '\n';
+			at = source.length();
+		}
+		else
+			at++;
+	}
+	int nextLine = 1;
+	for (size_t i=0 ; i<at ; i++)
+		if (source[i] == '\n')
+			nextLine++;
+	std::ostringstream text;
+	text << defines << "#line " << nextLine << '\n';
+	source.insert(at, text.str());
+}
+
+static const char PROGRAM_BINARY_MAGIC[8] = { 'S','h','a','d','e','r','I','F' };
+
 ShaderIF::ShaderIF(const std::string& vShader, const std::string& fShader) :
-	shaderPgm(0), numShaderComponents(2) // just a vertex & fragment shader
+	shaderPgm(0), numShaderComponents(2), // just a vertex & fragment shader
+	reloadCallback(NULL), reloadContext(NULL), reloading(NULL),
+	saveBinary(false), cacheKey(0)
 {
 	shaders = new Shader[numShaderComponents];
 	shaders[0].fName = vShader;
@@ -19,7 +104,9 @@ ShaderIF::ShaderIF(const std::string& vShader, const std::string& fShader) :
 }
 
 ShaderIF::ShaderIF(const ShaderSpec* shaders, int nShaders) :
-	shaderPgm(0), numShaderComponents(nShaders)
+	shaderPgm(0), numShaderComponents(nShaders),
+	reloadCallback(NULL), reloadContext(NULL), reloading(NULL),
+	saveBinary(false), cacheKey(0)
 {
 	this->shaders = new Shader[numShaderComponents];
 	for (int i=0 ; i<numShaderComponents ; i++)
@@ -30,15 +117,45 @@ ShaderIF::ShaderIF(const ShaderSpec* shaders, int nShaders) :
 	initShaders();
 }
 
+// With "finish" false, only startBuild is done; hot reloading uses this so
+// that the driver can compile in the background.
+ShaderIF::ShaderIF(const ShaderSpec* shaders, int nShaders, const std::string& defines,
+		bool finish) :
+	shaderPgm(0), numShaderComponents(nShaders), defines(defines),
+	reloadCallback(NULL), reloadContext(NULL), reloading(NULL),
+	saveBinary(false), cacheKey(0)
+{
+	this->shaders = new Shader[numShaderComponents];
+	for (int i=0 ; i<numShaderComponents ; i++)
+	{
+		this->shaders[i].fName = shaders[i].fName;
+		this->shaders[i].sType = shaders[i].sType;
+	}
+	if (startBuild() && finish)
+		finishBuild();
+}
+
 ShaderIF::~ShaderIF()
 {
+	stopWatching();
 	if (shaders != NULL)
 		delete [] shaders;
 	shaders = NULL;
+	for (std::map<std::string, ShaderIF*>::iterator it=variants.begin() ; it!=variants.end() ; it++)
+		delete it->second;
 }
 
 void ShaderIF::destroy()
 {
+	if (reloading != NULL)
+		reloading->destroy();
+	stopWatching();
+	for (std::map<std::string, ShaderIF*>::iterator it=variants.begin() ; it!=variants.end() ; it++)
+	{
+		it->second->destroy();
+		delete it->second;
+	}
+	variants.clear();
 	for (int si=0 ; si<numShaderComponents ; si++)
 	{
 		int sPgmID = shaders[si].pgmID;
@@ -57,30 +174,20 @@ void ShaderIF::destroy()
 	}
 	numShaderComponents = 0;
 }
-int ShaderIF::initShader(const std::string& vShader, const std::string& fShader)
-{
-	ShaderIF sIF(vShader, fShader);
-	return sIF.getShaderPgmID();
-}
-
-int ShaderIF::initShader(const ShaderSpec* shaders, int nShaders)
-{
-	ShaderIF sIF(shaders, nShaders);
-	return sIF.getShaderPgmID();
-}
 
-void ShaderIF::initShaders()
+// Checks the results of startBuild (waiting for them if need be). If the
+// program cannot be used, reports why and deletes it, returning false.
+bool ShaderIF::finishBuild()
 {
+	if (shaderPgm == 0) // a source file could not be read
+	{
+		destroy();
+		return false;
+	}
 	for (int i = 0; i < numShaderComponents; i++ )
 	{
-		if (!readShaderSource(shaders[i]))
-			return;
-
-		shaders[i].pgmID = glCreateShader(shaders[i].sType);
-		const char* src = shaders[i].source.c_str();
-		glShaderSource(shaders[i].pgmID, 1, &src, NULL);
-		glCompileShader(shaders[i].pgmID);
-		
+		if (shaders[i].pgmID == 0) // the program came from its binary
+			continue;
 		GLint  compiled;
 		glGetShaderiv(shaders[i].pgmID, GL_COMPILE_STATUS, &compiled );
 		if ( !compiled )
@@ -105,17 +212,10 @@ void ShaderIF::initShaders()
 				}
 			}
 			destroy();
-			return;
+			return false;
 		}
 	}
-	
-	shaderPgm = glCreateProgram();
-	for (int i=0 ; i<numShaderComponents ; i++)
-		glAttachShader(shaderPgm, shaders[i].pgmID);
-	
-	/* link  and error check */
-	glLinkProgram(shaderPgm);
-	
+
 	GLint  linked;
 	glGetProgramiv(shaderPgm, GL_LINK_STATUS, &linked);
 	if ( !linked )
@@ -137,7 +237,209 @@ void ShaderIF::initShaders()
 			std::cerr << "Could not allocate error log buffer of size: " << logSize << std::endl;
 		}
 		destroy();
+		return false;
+	}
+	if (saveBinary)
+		writeProgramBinary(cacheKey);
+	return true;
+}
+
+// Puts the finished rebuild in place of the program if it compiled and
+// linked; otherwise (its errors having been reported) the program stays.
+bool ShaderIF::finishReload()
+{
+	ShaderIF* rebuilt = reloading;
+	reloading = NULL;
+	if (!rebuilt->finishBuild())
+	{
+		std::cerr << "ShaderIF: still using the previous program built from "
+		          << shaders[0].fName << " et al.\n";
+		delete rebuilt;
+		return false;
 	}
+	// variants are rebuilt from the new sources when next asked for
+	for (std::map<std::string, ShaderIF*>::iterator it=variants.begin() ; it!=variants.end() ; it++)
+	{
+		it->second->destroy();
+		delete it->second;
+	}
+	variants.clear();
+	std::swap(shaders, rebuilt->shaders);
+	std::swap(shaderPgm, rebuilt->shaderPgm);
+	rebuilt->destroy(); // i.e., the previous program
+	delete rebuilt;
+	(*reloadCallback)(this, reloadContext);
+	return true;
+}
+
+int ShaderIF::getVariantPgmID(const std::vector<std::string>& defineList)
+{
+	std::string key;
+	for (size_t i=0 ; i<defineList.size() ; i++)
+		key += "#define " + defineList[i] + '\n';
+	if (key.empty())
+		return shaderPgm;
+	std::map<std::string, ShaderIF*>::iterator it = variants.find(key);
+	if (it == variants.end())
+	{
+		ShaderSpec* specs = new ShaderSpec[numShaderComponents];
+		for (int i=0 ; i<numShaderComponents ; i++)
+		{
+			specs[i].fName = shaders[i].fName;
+			specs[i].sType = shaders[i].sType;
+		}
+		it = variants.insert(std::make_pair(key, new ShaderIF(specs, numShaderComponents, key, true))).first;
+		delete [] specs;
+	}
+	return it->second->getShaderPgmID();
+}
+
+int ShaderIF::initShader(const std::string& vShader, const std::string& fShader)
+{
+	ShaderIF sIF(vShader, fShader);
+	return sIF.getShaderPgmID();
+}
+
+int ShaderIF::initShader(const ShaderSpec* shaders, int nShaders)
+{
+	ShaderIF sIF(shaders, nShaders);
+	return sIF.getShaderPgmID();
+}
+
+void ShaderIF::initShaders()
+{
+	if (startBuild())
+		finishBuild();
+}
+
+// True once the results of startBuild can be checked without waiting
+// (always, unless the driver has GL_KHR_parallel_shader_compile)
+bool ShaderIF::isBuildComplete() const
+{
+	if ((parallelCompile <= 0) || (shaderPgm == 0))
+		return true;
+	GLint complete;
+	glGetProgramiv(shaderPgm, GL_COMPLETION_STATUS_KHR, &complete);
+	return complete != 0;
+}
+
+// Starts rebuilding the programs whose source files have been saved since
+// the last call, and puts in place those whose rebuilds are complete.
+bool ShaderIF::pollForChanges() // CLASS METHOD
+{
+	if (reloadable.empty())
+		return false;
+	if (inotifyFD < 0)
+	{
+		inotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (inotifyFD < 0)
+		{
+			perror("ShaderIF: inotify_init1");
+			reloadable.clear();
+			return false;
+		}
+	}
+	// Watch the directories rather than the files: many editors save by
+	// writing a new file and renaming it over the old one.
+	for (size_t i=0 ; i<reloadable.size() ; i++)
+		for (int k=0 ; k<reloadable[i]->numShaderComponents ; k++)
+		{
+			std::string dir, base;
+			splitPath(reloadable[i]->shaders[k].fName, dir, base);
+			if (watchByDirectory.find(dir) != watchByDirectory.end())
+				continue;
+			int wd = inotify_add_watch(inotifyFD, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+			watchByDirectory[dir] = wd; // even if -1, so it is not retried every poll
+			if (wd >= 0)
+				directoryByWatch[wd] = dir;
+		}
+
+	std::set<ShaderIF*> changed;
+	char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	ssize_t n;
+	while ((n = read(inotifyFD, events, sizeof(events))) > 0)
+	{
+		const struct inotify_event* ev;
+		for (char* e=events ; e<events+n ; e+=sizeof(struct inotify_event)+ev->len)
+		{
+			ev = reinterpret_cast<const struct inotify_event*>(e);
+			std::map<int, std::string>::iterator dir = directoryByWatch.find(ev->wd);
+			if ((ev->len == 0) || (dir == directoryByWatch.end()))
+				continue;
+			for (size_t i=0 ; i<reloadable.size() ; i++)
+				for (int k=0 ; k<reloadable[i]->numShaderComponents ; k++)
+				{
+					std::string d, base;
+					splitPath(reloadable[i]->shaders[k].fName, d, base);
+					if ((d == dir->second) && (base == ev->name))
+						changed.insert(reloadable[i]);
+				}
+		}
+	}
+	for (std::set<ShaderIF*>::iterator it=changed.begin() ; it!=changed.end() ; it++)
+		(*it)->startReload();
+
+	bool replaced = false;
+	for (size_t i=0 ; i<reloadable.size() ; i++)
+		if ((reloadable[i]->reloading != NULL) && reloadable[i]->reloading->isBuildComplete())
+			replaced = reloadable[i]->finishReload() || replaced;
+	return replaced;
+}
+
+// The key identifies the sources (in order, with their types) and the
+// driver; any change to either yields a different binary file.
+unsigned long long ShaderIF::programCacheKey() const
+{
+	unsigned long long key = hashBytes(PROGRAM_BINARY_MAGIC, sizeof(PROGRAM_BINARY_MAGIC));
+	key = hashString(reinterpret_cast<const char*>(glGetString(GL_VENDOR)), key);
+	key = hashString(reinterpret_cast<const char*>(glGetString(GL_RENDERER)), key);
+	key = hashString(reinterpret_cast<const char*>(glGetString(GL_VERSION)), key);
+	for (int i=0 ; i<numShaderComponents ; i++)
+	{
+		key = hashBytes(&shaders[i].sType, sizeof(shaders[i].sType), key);
+		key = hashString(shaders[i].source.c_str(), key);
+	}
+	return key;
+}
+
+static std::string programBinaryFileName(const std::string& dirName, unsigned long long key)
+{
+	char name[32];
+	sprintf(name, "/%016llx.bin", key);
+	return dirName + name;
+}
+
+// Reads the cached binary for "key", if there is one the driver accepts.
+bool ShaderIF::readProgramBinary(unsigned long long key)
+{
+	std::ifstream is(programBinaryFileName(programCacheDirectory, key).c_str(),
+		std::ios::binary);
+	char magic[sizeof(PROGRAM_BINARY_MAGIC)];
+	unsigned long long fileKey;
+	GLenum format;
+	GLint length;
+	is.read(magic, sizeof(magic));
+	is.read(reinterpret_cast<char*>(&fileKey), sizeof(fileKey));
+	is.read(reinterpret_cast<char*>(&format), sizeof(format));
+	is.read(reinterpret_cast<char*>(&length), sizeof(length));
+	if (!is || (memcmp(magic, PROGRAM_BINARY_MAGIC, sizeof(magic)) != 0) ||
+		(fileKey != key) || (length <= 0))
+		return false;
+	std::string binary(length, '\0');
+	if (!is.read(&binary[0], length))
+		return false;
+
+	shaderPgm = glCreateProgram();
+	glProgramBinary(shaderPgm, format, binary.data(), length);
+	GLint linked;
+	glGetProgramiv(shaderPgm, GL_LINK_STATUS, &linked);
+	if (!linked) // e.g., a driver update: fall back to compiling
+	{
+		glDeleteProgram(shaderPgm);
+		shaderPgm = 0;
+		return false;
+	}
+	return true;
 }
 
 bool ShaderIF::readShaderSource(Shader& shader) // CLASS METHOD
@@ -148,12 +450,150 @@ bool ShaderIF::readShaderSource(Shader& shader) // CLASS METHOD
 		std::cerr << "Could not open " << shader.fName << " for reading.\n";
 		return false;
 	}
-	std::string line;
-	getline(is, line);
-	while (!is.eof())
+	std::ostringstream source;
+	source << is.rdbuf();
+	shader.source = source.str();
+	return true;
+}
+
+void ShaderIF::setProgramCacheDirectory(const std::string& dirName) // CLASS METHOD
+{
+	programCacheDirectory = dirName;
+}
+
+void ShaderIF::setReloadCallback(ReloadCallback callback, void* context)
+{
+	if (callback == NULL)
 	{
-		shader.source = shader.source + line + '\n';
-		getline(is, line);
+		stopWatching();
+		return;
 	}
+	reloadCallback = callback;
+	reloadContext = context;
+	if ((numShaderComponents > 0) &&
+			(std::find(reloadable.begin(), reloadable.end(), this) == reloadable.end()))
+		reloadable.push_back(this);
+}
+
+// Reads the sources and issues the commands that build the program (or
+// loads its cached binary) without asking for any results, so that a
+// driver with GL_KHR_parallel_shader_compile can do the work in the
+// background. Returns false if a source file could not be read.
+bool ShaderIF::startBuild()
+{
+	for (int i = 0; i < numShaderComponents; i++ )
+	{
+		if (!readShaderSource(shaders[i]))
+			return false;
+		if (defines.length() > 0)
+			insertDefines(shaders[i].source, defines);
+	}
+
+	GLint nBinaryFormats = 0;
+	if (programCacheDirectory.length() > 0)
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nBinaryFormats);
+	saveBinary = (nBinaryFormats > 0);
+	if (saveBinary)
+	{
+		cacheKey = programCacheKey();
+		if (readProgramBinary(cacheKey))
+		{
+			saveBinary = false;
+			return true;
+		}
+	}
+
+	for (int i = 0; i < numShaderComponents; i++ )
+	{
+		shaders[i].pgmID = glCreateShader(shaders[i].sType);
+		const char* src = shaders[i].source.c_str();
+		glShaderSource(shaders[i].pgmID, 1, &src, NULL);
+		glCompileShader(shaders[i].pgmID);
+	}
+
+	shaderPgm = glCreateProgram();
+	for (int i=0 ; i<numShaderComponents ; i++)
+		glAttachShader(shaderPgm, shaders[i].pgmID);
+	if (saveBinary)
+		glProgramParameteri(shaderPgm, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(shaderPgm);
 	return true;
 }
+
+// Begins building a new program from the current sources, abandoning any
+// rebuild already under way.
+void ShaderIF::startReload()
+{
+	if (parallelCompile < 0)
+	{
+		// Its default of 0xFFFFFFFF compiler threads lets the driver choose.
+		parallelCompile = 0;
+		GLint nExtensions = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &nExtensions);
+		for (int i=0 ; i<nExtensions ; i++)
+		{
+			const char* ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+			if ((ext != NULL) && (strcmp(ext, "GL_KHR_parallel_shader_compile") == 0))
+				parallelCompile = 1;
+		}
+	}
+	if (reloading != NULL)
+	{
+		reloading->destroy();
+		delete reloading;
+	}
+	ShaderSpec* specs = new ShaderSpec[numShaderComponents];
+	for (int i=0 ; i<numShaderComponents ; i++)
+	{
+		specs[i].fName = shaders[i].fName;
+		specs[i].sType = shaders[i].sType;
+	}
+	reloading = new ShaderIF(specs, numShaderComponents, defines, false);
+	delete [] specs;
+}
+
+void ShaderIF::stopWatching()
+{
+	if (reloading != NULL)
+	{
+		delete reloading; // destroy()'d first if the context is still around
+		reloading = NULL;
+	}
+	reloadable.erase(std::remove(reloadable.begin(), reloadable.end(), this), reloadable.end());
+	reloadCallback = NULL;
+	reloadContext = NULL;
+}
+
+// Saves the binary of the just-linked program. It is written to a temporary
+// file that is then renamed, so a concurrent reader never sees part of one.
+void ShaderIF::writeProgramBinary(unsigned long long key) const
+{
+	GLint length = 0;
+	glGetProgramiv(shaderPgm, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+	std::string binary(length, '\0');
+	GLenum format;
+	glGetProgramBinary(shaderPgm, length, &length, &format, &binary[0]);
+
+	// create the directory (and any missing parents)
+	for (size_t slash=programCacheDirectory.find('/', 1) ; ;
+			slash=programCacheDirectory.find('/', slash+1))
+	{
+		mkdir(programCacheDirectory.substr(0, slash).c_str(), 0755);
+		if (slash == std::string::npos)
+			break;
+	}
+	std::string fileName = programBinaryFileName(programCacheDirectory, key);
+	std::ostringstream tmpName;
+	tmpName << fileName << '.' << getpid();
+	std::ofstream os(tmpName.str().c_str(), std::ios::binary);
+	os.write(PROGRAM_BINARY_MAGIC, sizeof(PROGRAM_BINARY_MAGIC));
+	os.write(reinterpret_cast<const char*>(&key), sizeof(key));
+	os.write(reinterpret_cast<const char*>(&format), sizeof(format));
+	os.write(reinterpret_cast<const char*>(&length), sizeof(length));
+	os.write(binary.data(), length);
+	os.close();
+	if (!os || (rename(tmpName.str().c_str(), fileName.c_str()) != 0))
+		unlink(tmpName.str().c_str());
+}
@@ -5,7 +5,9 @@
 
 #include <GL/gl.h>
 
+#include <map>
 #include <string>
+#include <vector>
 
 class ShaderIF
 {
@@ -51,6 +53,37 @@ public:
 	// the compiled and linked shader programs to live after those methods have
 	// exited, deleting the local ShaderIF object created internally.
 	void destroy();
+
+	// Linked programs can be cached (via glGetProgramBinary) as files in the
+	// given directory, which is created if need be. A program is then loaded
+	// from its binary instead of being compiled and linked, as long as
+	// neither its shader sources nor the GL driver have changed. An empty
+	// name (the default) turns caching off.
+	static void setProgramCacheDirectory(const std::string& dirName);
+
+	// Variants: the program built from the same sources with the given
+	// macros (e.g., "SHAPE_ATTRIBUTE pvaSet1.x") #define'd just after each
+	// shader's #version line, so that shaders can replace branches on
+	// uniforms with code specialized for a particular configuration. Each
+	// distinct list is compiled the first time it is asked for and kept
+	// until destroy(). An empty list yields getShaderPgmID(); 0 is returned
+	// if the variant fails to compile or link.
+	int getVariantPgmID(const std::vector<std::string>& defines);
+
+	// Hot reloading, for editing shaders while the program runs: once a
+	// callback is set, pollForChanges (to be called regularly on the thread
+	// whose context is current, e.g., from a timer) notices when one of the
+	// source files is saved and rebuilds the program, in the background if
+	// the driver has GL_KHR_parallel_shader_compile. The rebuilt program is
+	// swapped in by the call to pollForChanges that finds it complete, not
+	// by rendering: if it succeeded, it replaces getShaderPgmID() (the
+	// variants are dropped) and the callback is made, then and there, so
+	// that the client can fetch its variable locations again; if not, its
+	// errors are reported and the old program stays. pollForChanges returns
+	// true if any program was replaced, so that the caller can redisplay.
+	typedef void (*ReloadCallback)(ShaderIF* reloaded, void* context);
+	void setReloadCallback(ReloadCallback callback, void* context=NULL);
+	static bool pollForChanges();
 private:
 	struct Shader
 	{
@@ -61,13 +94,33 @@ private:
 
 		Shader(): fName(""), sType(0), source(""), pgmID(0) {}
 	};
+	ShaderIF(const ShaderSpec* shaders, int nShaders, const std::string& defines,
+		bool finish);
+	bool finishBuild();
+	bool finishReload();
 	void initShaders();
+	bool isBuildComplete() const;
+	unsigned long long programCacheKey() const;
+	bool readProgramBinary(unsigned long long key);
+	bool startBuild();
+	void startReload();
+	void stopWatching();
+	void writeProgramBinary(unsigned long long key) const;
 
 	static bool readShaderSource(Shader& shader);
 
+	static std::string programCacheDirectory;
+
 	int shaderPgm;
 	int numShaderComponents;
 	Shader* shaders;
+	std::string defines; // "#define" lines inserted in each source
+	std::map<std::string, ShaderIF*> variants; // by their "defines"
+	ReloadCallback reloadCallback;
+	void* reloadContext;
+	ShaderIF* reloading; // the rebuild from edited sources, while under way
+	bool saveBinary; // once linked, under cacheKey
+	unsigned long long cacheKey;
 };
 
 #endif
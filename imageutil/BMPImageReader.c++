@@ -4,6 +4,8 @@
 //  Documentation on use:
 //      http://people.eecs.ku.edu/~miller/Courses/ToolDoc/ImageReader.html
 
+#include <mutex>
+
 #include "BMPLoader.h"
 #include "BMPImageReader.h"
 
@@ -15,8 +17,9 @@ BMPImageReader::BMPImageReader(const BMPImageReader& b) : ImageReader(b)
 
 // Here are the supported constructors
 
-BMPImageReader::BMPImageReader(std::string fileName) :
-	ImageReader(fileName)
+BMPImageReader::BMPImageReader(std::string fileName,
+		const ImageDestination* destination) :
+	ImageReader(fileName, destination)
 {
 	readImage();
 }
@@ -26,19 +29,20 @@ bool BMPImageReader::read()
 	int			widthOut, heightOut, nChannelsOut;
 	GLubyte*	pixels;
 
-	LOAD_TEXTUREBMP_RESULT res = loadBMPData(fullFileName.c_str(),&pixels,
+	// BMPLoader keeps its state in file statics, so only one thread
+	// at a time may use it.
+	static std::mutex loaderMutex;
+	LOAD_TEXTUREBMP_RESULT res;
+	{
+		std::lock_guard<std::mutex> lock(loaderMutex);
+		res = loadBMPData(fullFileName.c_str(),&pixels,
 										widthOut, heightOut, nChannelsOut);
+	}
 	if ( (pixels == NULL) || (res != LOAD_TEXTUREBMP_SUCCESS) )
 		return false;
 
-	theImage = new cryph::Packed3DArray<GLubyte>(
-							heightOut, widthOut, nChannelsOut);
-	int nextPixel = 0;
-	for (int i=0 ; i<heightOut ; i++)
-		for (int j=0 ; j<widthOut ; j++)
-			for (int k=0 ; k<nChannelsOut ; k++)
-				theImage->setDataElement(i,j,k,pixels[nextPixel++]);
-	delete [] pixels;
+	// the loader's buffer is already in our layout
+	allocateImage(heightOut, widthOut, nChannelsOut, pixels);
 
     return true;
 }
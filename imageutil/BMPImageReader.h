@@ -12,7 +12,8 @@
 class BMPImageReader : public ImageReader
 {
 public:
-	BMPImageReader(std::string fileName);
+	BMPImageReader(std::string fileName,
+		const ImageDestination* destination=NULL);
 
 protected:
 	BMPImageReader(const BMPImageReader& s); // cannot use the copy constructor
@@ -0,0 +1,254 @@
+// ImageLoader.c++ -- decode image files on worker threads, with an LRU cache
+
+#include <sys/stat.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ImageLoader.h"
+
+namespace
+{
+
+// A fixed set of threads running queued tasks in order
+class WorkerPool
+{
+public:
+	WorkerPool(int nThreads) : stopping(false)
+	{
+		for (int i=0 ; i<nThreads ; i++)
+			threads.push_back(std::thread(&WorkerPool::work, this));
+	}
+
+	~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true; // tasks not yet started are dropped
+		}
+		wake.notify_all();
+		for (size_t i=0 ; i<threads.size() ; i++)
+			threads[i].join();
+	}
+
+	void submit(const std::function<void()>& task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			tasks.push_back(task);
+		}
+		wake.notify_one();
+	}
+
+private:
+	void work()
+	{
+		for (;;)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				while (!stopping && tasks.empty())
+					wake.wait(lock);
+				if (stopping)
+					return;
+				task = tasks.front();
+				tasks.pop_front();
+			}
+			task();
+		}
+	}
+
+	std::vector<std::thread> threads;
+	std::deque<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping;
+};
+
+struct CacheEntry
+{
+	std::string fileName;
+	struct timespec mtime; // of the file when it was decoded
+	off_t fileSize;
+	unsigned long id; // distinguishes successive entries for a file
+	std::shared_future<ImageLoader::Image> image;
+	size_t bytes; // 0 until decoded
+};
+
+// All of it is guarded by "mutex". The pool is declared last so that its
+// threads are joined before anything they use is destroyed.
+struct LoaderState
+{
+	LoaderState() : capacity(64*1024*1024), size(0), nextID(0), nThreads(0) {}
+
+	std::mutex mutex;
+	std::list<CacheEntry> lru; // most recently used first
+	std::map<std::string, std::list<CacheEntry>::iterator> byName;
+	size_t capacity, size;
+	unsigned long nextID;
+	int nThreads;
+	std::unique_ptr<WorkerPool> pool;
+};
+
+LoaderState& state()
+{
+	static LoaderState s;
+	return s;
+}
+
+// The functions below expect the caller to hold the state's mutex.
+
+void evict(LoaderState& s)
+{
+	std::list<CacheEntry>::iterator it = s.lru.end();
+	while ((s.size > s.capacity) && (it != s.lru.begin()))
+	{
+		--it;
+		if (it->bytes == 0) // still being decoded
+			continue;
+		s.size -= it->bytes;
+		s.byName.erase(it->fileName);
+		it = s.lru.erase(it);
+	}
+}
+
+WorkerPool& getPool(LoaderState& s)
+{
+	if (!s.pool)
+	{
+		int n = s.nThreads;
+		if (n < 1)
+			n = std::thread::hardware_concurrency();
+		s.pool.reset(new WorkerPool((n < 1) ? 1 : n));
+	}
+	return *s.pool;
+}
+
+void dropEntry(LoaderState& s, std::map<std::string, std::list<CacheEntry>::iterator>::iterator found)
+{
+	s.size -= found->second->bytes;
+	s.lru.erase(found->second);
+	s.byName.erase(found);
+}
+
+// Runs on a worker thread
+ImageLoader::Image decode(const std::string& fileName, unsigned long id)
+{
+	ImageLoader::Image image(ImageReader::create(fileName));
+	LoaderState& s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+	std::map<std::string, std::list<CacheEntry>::iterator>::iterator found =
+		s.byName.find(fileName);
+	if ((found == s.byName.end()) || (found->second->id != id))
+		; // dropped (or replaced) while being decoded
+	else if (image == NULL) // let a later request try again
+		dropEntry(s, found);
+	else
+	{
+		const cryph::Packed3DArray<GLubyte>* pixels = image->getInternalPacked3DArrayImage();
+		found->second->bytes = pixels->getTotalNumberElements();
+		s.size += found->second->bytes;
+		evict(s);
+	}
+	return image;
+}
+
+}
+
+void ImageLoader::clearCache()
+{
+	LoaderState& s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+	s.lru.clear();
+	s.byName.clear();
+	s.size = 0;
+}
+
+std::future<bool> ImageLoader::decodeAsync(const std::string& fileName,
+	const ImageDestination& destination)
+{
+	std::shared_ptr<std::packaged_task<bool()>> task(new std::packaged_task<bool()>(
+		[fileName, destination]
+		{
+			ImageReader* ir = ImageReader::create(fileName, destination);
+			bool decoded = (ir != NULL);
+			delete ir; // the pixels stay in the destination's storage
+			return decoded;
+		}));
+	std::future<bool> result = task->get_future();
+	LoaderState& s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+	getPool(s).submit([task] { (*task)(); });
+	return result;
+}
+
+size_t ImageLoader::getCacheSize()
+{
+	LoaderState& s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+	return s.size;
+}
+
+std::shared_future<ImageLoader::Image> ImageLoader::loadAsync(const std::string& fileName)
+{
+	struct stat info;
+	if (stat(fileName.c_str(), &info) != 0)
+	{
+		std::promise<Image> none;
+		none.set_value(Image());
+		return none.get_future().share();
+	}
+
+	LoaderState& s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+	std::map<std::string, std::list<CacheEntry>::iterator>::iterator found =
+		s.byName.find(fileName);
+	if (found != s.byName.end())
+	{
+		std::list<CacheEntry>::iterator it = found->second;
+		if ((it->mtime.tv_sec == info.st_mtim.tv_sec) &&
+			(it->mtime.tv_nsec == info.st_mtim.tv_nsec) && (it->fileSize == info.st_size))
+		{
+			s.lru.splice(s.lru.begin(), s.lru, it);
+			return it->image;
+		}
+		dropEntry(s, found); // the file has changed
+	}
+
+	unsigned long id = ++s.nextID;
+	std::shared_ptr<std::packaged_task<Image()>> task(new std::packaged_task<Image()>(
+		[fileName, id] { return decode(fileName, id); }));
+	CacheEntry entry;
+	entry.fileName = fileName;
+	entry.mtime = info.st_mtim;
+	entry.fileSize = info.st_size;
+	entry.id = id;
+	entry.image = task->get_future().share();
+	entry.bytes = 0;
+	s.lru.push_front(entry);
+	s.byName[fileName] = s.lru.begin();
+	getPool(s).submit([task] { (*task)(); });
+	return entry.image;
+}
+
+void ImageLoader::setCacheCapacity(size_t bytes)
+{
+	LoaderState& s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+	s.capacity = bytes;
+	evict(s);
+}
+
+void ImageLoader::setNumThreads(int n)
+{
+	LoaderState& s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+	s.nThreads = n;
+}
@@ -0,0 +1,52 @@
+// ImageLoader.h -- Decodes image files (anything ImageReader can read) on a
+//                  pool of worker threads. Decoded images are kept in an LRU
+//                  cache keyed by file name and modification time, so asking
+//                  again for an unchanged file costs nothing; requests for a
+//                  file already being decoded share that decoding.
+//
+// Quick synopsis of use:
+//    std::shared_future<ImageLoader::Image> f = ImageLoader::loadAsync(name);
+//    ... (start others; do other work)
+//    ImageLoader::Image im = f.get(); // NULL if the file could not be read
+//
+// The ImageReader class settings (setEnsureAlphaChannel, etc.) should be made
+// before any loading; cached images keep the settings they were decoded with.
+
+#ifndef IMAGELOADER_H
+#define IMAGELOADER_H
+
+#include <future>
+#include <memory>
+#include <string>
+
+#include "ImageReader.h"
+
+class ImageLoader
+{
+public:
+	typedef std::shared_ptr<const ImageReader> Image;
+
+	static std::shared_future<Image> loadAsync(const std::string& fileName);
+	static Image load(const std::string& fileName)
+		{ return loadAsync(fileName).get(); }
+
+	// Decodes "fileName" (bypassing the cache) straight into the storage
+	// supplied by "destination", whose callbacks are made on a worker
+	// thread. (See ImageReader::create.) The result is false if the file
+	// could not be read; destination.context must remain valid until then.
+	static std::future<bool> decodeAsync(const std::string& fileName,
+						const ImageDestination& destination);
+
+	static void		clearCache();
+	static size_t	getCacheSize(); // bytes of decoded pixels held
+	// Least recently used images are dropped as needed to keep the cache
+	// within "bytes" (default: 64MB).
+	static void		setCacheCapacity(size_t bytes);
+	// Effective only before the first load (default: one per hardware thread)
+	static void		setNumThreads(int n);
+
+private:
+	ImageLoader() {} // only class methods
+};
+
+#endif
@@ -38,15 +38,45 @@ ImageReader::ImageReader(const ImageReader&)
 
 // Here are the supported constructors
 
-ImageReader::ImageReader(const std::string& fileName) :
+ImageReader::ImageReader(const std::string& fileName,
+		const ImageDestination* destination) :
 	theImage(NULL), border(0),
 	fullFileName(fileName), debug(ImageReader::defaultDebug),
-	readFailed(false), textureID(0)
+	readFailed(false), textureID(0),
+	destination(destination), rowsReported(false)
 {
 }
 
+ImageReader::~ImageReader()
+{
+	if (theImage != NULL)
+		delete theImage;
+}
+
 // Methods....
 
+void ImageReader::allocateImage(int nRows, int nCols, int nChannels,
+	GLubyte* decoded)
+{
+	GLubyte* storage = NULL;
+	if ((destination != NULL) && (destination->allocate != NULL))
+		storage = destination->allocate(nRows, nCols, nChannels, destination->context);
+	if (storage != NULL) // borrowed: never freed by theImage
+	{
+		theImage = new cryph::Packed3DArray<GLubyte>(storage, nRows, nCols, nChannels);
+		if (decoded != NULL)
+		{
+			memcpy(storage, decoded, nRows*nCols*nChannels);
+			delete [] decoded;
+		}
+	}
+	else if (decoded != NULL)
+		theImage = new cryph::Packed3DArray<GLubyte>(decoded, nRows, nCols, nChannels,
+						cryph::Packed3DArray<GLubyte>::adoptNewArray);
+	else
+		theImage = new cryph::Packed3DArray<GLubyte>(nRows, nCols, nChannels);
+}
+
 ImageReader* ImageReader::create(std::string fileName, bool debug) // CLASS METHOD
 {
 	ifstream seeIfExists(fileName.c_str());
@@ -54,7 +84,7 @@ ImageReader* ImageReader::create(std::string fileName, bool debug) // CLASS METH
 		seeIfExists.close();
 	else
 		return NULL;
-	ImageReader* p = guessFileType(fileName);
+	ImageReader* p = guessFileType(fileName, NULL);
 	if (p == NULL)
 		return NULL;
 
@@ -70,12 +100,13 @@ ImageReader* ImageReader::create(std::string fileName, bool debug) // CLASS METH
 		int nRows = p->theImage->getDim1();
 		int nCols = p->theImage->getDim2();
 		cryph::Packed3DArray<GLubyte>* grayImage = new cryph::Packed3DArray<GLubyte>(nRows, nCols, 3);
+		const cryph::Packed3DArray<GLubyte>& from = *p->theImage;
+		cryph::Packed3DArray<GLubyte>& to = *grayImage;
 		for (int i=0 ; i<nRows ; i++)
 			for (int j=0 ; j<nCols ; j++)
 			{
-				GLubyte b = p->theImage->getDataElement(i,j,0);
-				for (int k=0 ; k<3 ; k++)
-					grayImage->setDataElement(i,j,k,b);
+				GLubyte b = from(i,j,0);
+				to(i,j,0) = b; to(i,j,1) = b; to(i,j,2) = b;
 			}
 		delete p->theImage;
 		p->theImage = grayImage;
@@ -86,15 +117,14 @@ ImageReader* ImageReader::create(std::string fileName, bool debug) // CLASS METH
 		int nCols = p->theImage->getDim2();
 		cryph::Packed3DArray<GLubyte>* imageWithAlpha =
 			new cryph::Packed3DArray<GLubyte>(nRows, nCols, 4);
+		const cryph::Packed3DArray<GLubyte>& from = *p->theImage;
+		cryph::Packed3DArray<GLubyte>& to = *imageWithAlpha;
 		for (int i=0 ; i<nRows ; i++)
 			for (int j=0 ; j<nCols ; j++)
 			{
 				for (int k=0 ; k<3 ; k++)
-				{
-					GLubyte b = p->theImage->getDataElement(i,j,k);
-					imageWithAlpha->setDataElement(i,j,k,b);
-				}
-				imageWithAlpha->setDataElement(i,j,3,255);
+					to(i,j,k) = from(i,j,k);
+				to(i,j,3) = 255;
 			}
 		delete p->theImage;
 		p->theImage = imageWithAlpha;
@@ -102,6 +132,27 @@ ImageReader* ImageReader::create(std::string fileName, bool debug) // CLASS METH
 	return p;
 }
 
+ImageReader* ImageReader::create(std::string fileName,
+	const ImageDestination& destination, bool debug) // CLASS METHOD
+{
+	ifstream seeIfExists(fileName.c_str());
+	if (seeIfExists.good())
+		seeIfExists.close();
+	else
+		return NULL;
+	ImageReader* p = guessFileType(fileName, &destination);
+	if (p == NULL)
+		return NULL;
+	p->destination = NULL;
+	if (p->readFailed)
+	{
+		delete p;
+		return NULL;
+	}
+	p->setDebug(debug);
+	return p;
+}
+
 int ImageReader::getBorder() const
 {
 	return border;
@@ -162,22 +213,23 @@ GLenum ImageReader::getType() const
 	return GL_UNSIGNED_BYTE;
 }
 
-ImageReader* ImageReader::guessFileType(const std::string& fileName) // CLASS METHOD
+ImageReader* ImageReader::guessFileType(const std::string& fileName,
+	const ImageDestination* destination) // CLASS METHOD
 {
 	int dotLoc = fileName.find_last_of('.');
 	if (dotLoc != std::string::npos)
 	{
 		std::string extension = fileName.substr(dotLoc+1);
 		if ((extension.compare("bmp") == 0) || (extension.compare("BMP") == 0))
-			return new BMPImageReader(fileName);
+			return new BMPImageReader(fileName, destination);
 		if ((extension.compare("jpg") == 0) || (extension.compare("JPG") == 0))
-			return new JPEGImageReader(fileName);
+			return new JPEGImageReader(fileName, destination);
 		if ((extension.compare("jpeg") == 0) || (extension.compare("JPEG") == 0))
-			return new JPEGImageReader(fileName);
+			return new JPEGImageReader(fileName, destination);
 		if ((extension.compare("png") == 0) || (extension.compare("PNG") == 0))
-			return new PNGImageReader(fileName);
+			return new PNGImageReader(fileName, destination);
 		if ((extension.compare("tga") == 0) || (extension.compare("TGA") == 0))
-			return new TGAImageReader(fileName);
+			return new TGAImageReader(fileName, destination);
 	}
 
 	cerr << "ImageReader::guessFileType cannot determine file type of: "
@@ -188,6 +240,16 @@ ImageReader* ImageReader::guessFileType(const std::string& fileName) // CLASS ME
 void ImageReader::readImage()
 {
 	readFailed = !read();
+	// readers that do not stream rows deliver them all at the end
+	if (!readFailed && !rowsReported)
+		reportRowsDecoded(0, theImage->getDim1());
+}
+
+void ImageReader::reportRowsDecoded(int firstRow, int nRows)
+{
+	rowsReported = true;
+	if ((destination != NULL) && (destination->rowsDecoded != NULL))
+		destination->rowsDecoded(firstRow, nRows, destination->context);
 }
 
 void ImageReader::setTextureID(GLuint tID)
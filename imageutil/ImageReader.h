@@ -26,9 +26,25 @@
 
 #include "Packed3DArray.h"
 
+// Where a reader puts the pixels it decodes; see ImageReader::create.
+// The callbacks are made on the thread doing the decoding.
+struct ImageDestination
+{
+	// Called once the size of the image is known. Returns storage for
+	// nRows*nCols*nChannels bytes laid out as getTexture's (rows
+	// bottom-up, channels interleaved) -- e.g., a mapped pixel unpack
+	// buffer -- or NULL to let the reader allocate it as usual.
+	GLubyte*	(*allocate)(int nRows, int nCols, int nChannels, void* context);
+	// If not NULL, called as runs of rows hold their final values.
+	void		(*rowsDecoded)(int firstRow, int nRows, void* context);
+	void*		context;
+};
+
 class ImageReader
 {
 public:
+	virtual ~ImageReader();
+
 	// Methods to return appropriate values for various parameters to
 	// OpenGL functions like glTexImage2D, glDrawPixels, etc.
 	int		getBorder() const;
@@ -63,6 +79,14 @@ public:
 	//             responsible for deleting it when it is done with it.
 	static ImageReader*	create(std::string fileName,
 						bool debug=ImageReader::defaultDebug);
+	//             This version decodes into the storage "destination"
+	//             supplies, streaming rows to it as they are decoded. Since
+	//             that storage belongs to the caller, the image keeps the
+	//             channels of the file: neither single channel promotion nor
+	//             the alpha channel option is applied to it.
+	static ImageReader*	create(std::string fileName,
+						const ImageDestination& destination,
+						bool debug=ImageReader::defaultDebug);
 	// 2. Miscellaneous
 	static void setDefaultDebug(bool b) { defaultDebug = b; }
 	static void	setEnsureAlphaChannel(bool b) { ensureAlphaChannel = b; }
@@ -73,13 +97,22 @@ protected:
 	// Since the class is abstract, you CANNOT use these constructors.
 	// Use instead the class method "create" or create instances of
 	// concrete subclasses (TGAImageReader, RGBImageReader, etc.)
-	ImageReader(const std::string& fileName);
+	ImageReader(const std::string& fileName,
+		const ImageDestination* destination=NULL);
 
 	ImageReader(const ImageReader& s); // cannot use the copy constructor
 
 	virtual bool read() = 0;
 	void	readImage();
 
+	// For use by "read": allocate theImage (in the destination's storage,
+	// if any), and report rows that are complete. A reader that has
+	// already decoded the whole image into memory from new[] passes it as
+	// "decoded": theImage adopts it, or it is copied to the destination.
+	void	allocateImage(int nRows, int nCols, int nChannels,
+				GLubyte* decoded=NULL);
+	void	reportRowsDecoded(int firstRow, int nRows);
+
 	// The image read from the file
 	cryph::Packed3DArray<GLubyte>*	theImage;
 
@@ -91,9 +124,12 @@ protected:
 private:
 
 	// Other private instance methods:
-	static ImageReader* guessFileType(const std::string& fileName);
+	static ImageReader* guessFileType(const std::string& fileName,
+						const ImageDestination* destination);
 
 	GLuint textureID;
+	const ImageDestination* destination; // only during construction
+	bool	rowsReported;
 
 	static bool defaultDebug;
 	static bool	ensureAlphaChannel, promoteSingleChannelToGray;
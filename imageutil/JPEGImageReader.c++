@@ -20,8 +20,9 @@ JPEGImageReader::JPEGImageReader(const JPEGImageReader& j) : ImageReader(j)
 
 // Here are the supported constructors
 
-JPEGImageReader::JPEGImageReader(std::string fileName) :
-	ImageReader(fileName)
+JPEGImageReader::JPEGImageReader(std::string fileName,
+		const ImageDestination* destination) :
+	ImageReader(fileName, destination)
 {
 	readImage();
 }
@@ -66,8 +67,7 @@ bool JPEGImageReader::read()
 	}
 
 	// storage for OpenGL image
-	theImage = new cryph::Packed3DArray<GLubyte>
-				(cinfo.image_height, cinfo.image_width, cinfo.out_color_components);
+	allocateImage(cinfo.image_height, cinfo.image_width, cinfo.out_color_components);
 
 	// JDIMENSION is unsigned int
 	// JSAMPLE is short
@@ -84,29 +84,22 @@ bool JPEGImageReader::read()
 	// JDIMENSION jpeg_read_scanlines (j_decompress_ptr cinfo,
     //                 JSAMPARRAY scanlines, JDIMENSION max_lines);
 
+	// Scan lines are decoded straight into the rows of theImage. JPEG
+	// stores them top-down, so scan line s is image row (nRows-1-s).
 	JSAMPARRAY scanlines = new JSAMPROW[cinfo.rec_outbuf_height];
-	int nCols = theImage->getDim2();
-	int nChannels = theImage->getDim3();
-	for (int i=0 ; i<cinfo.rec_outbuf_height ; i++)
-		scanlines[i] = new JSAMPLE[nCols*nChannels];
 
 	JDIMENSION totalLinesRead = 0;
 	int setRow = theImage->getDim1() - 1;
 	while (cinfo.output_scanline < cinfo.output_height)
 	{
-		JDIMENSION res = jpeg_read_scanlines(&cinfo,scanlines,
-			cinfo.rec_outbuf_height);
-		for (int ii=0 ; ii<res ; ii++)
-		{
-			for (int jj=0 ; jj<nChannels*nCols ; jj+=nChannels)
-			{
-				int setCol = jj / nChannels;
-				for (int kk=0 ; kk<nChannels ; kk++)
-					theImage->setDataElement(setRow,setCol,kk,
-							scanlines[ii][jj+kk]);
-			}
-			setRow--;
-		}
+		int nLines = cinfo.rec_outbuf_height;
+		if (nLines > setRow + 1)
+			nLines = setRow + 1;
+		for (int ii=0 ; ii<nLines ; ii++)
+			scanlines[ii] = theImage->getPlane(setRow - ii).data;
+		JDIMENSION res = jpeg_read_scanlines(&cinfo,scanlines,nLines);
+		setRow -= res;
+		reportRowsDecoded(setRow + 1, res);
 		totalLinesRead += res;
 	}
 	if (debug)
@@ -116,8 +109,6 @@ bool JPEGImageReader::read()
 	fclose(fp);
 	jpeg_destroy_decompress(&cinfo);
 
-	for (int i=0 ; i<cinfo.rec_outbuf_height ; i++)
-		delete [] scanlines[i];
 	delete [] scanlines;
 
 	return true;
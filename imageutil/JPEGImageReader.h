@@ -12,7 +12,8 @@
 class JPEGImageReader : public ImageReader
 {
 public:
-	JPEGImageReader(std::string fileName);
+	JPEGImageReader(std::string fileName,
+		const ImageDestination* destination=NULL);
 
 protected:
 	JPEGImageReader(const JPEGImageReader& s); // cannot use the copy constructor
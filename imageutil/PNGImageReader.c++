@@ -20,8 +20,9 @@ PNGImageReader::PNGImageReader(const PNGImageReader& j) : ImageReader(j)
 
 // Here are the supported constructors
 
-PNGImageReader::PNGImageReader(std::string fileName) :
-	ImageReader(fileName)
+PNGImageReader::PNGImageReader(std::string fileName,
+		const ImageDestination* destination) :
+	ImageReader(fileName, destination)
 {
 	readImage();
 }
@@ -115,15 +116,20 @@ bool PNGImageReader::read()
 		return false;
 	if (debug)
 		cout << "PNGImageReader::read - nChannels = " << nChannels << '\n';
-	theImage = new cryph::Packed3DArray<GLubyte>(height, width, nChannels);
-	GLubyte* p = theImage->getModifiableData();
-	png_bytep* row_pointers = new png_byte*[height];
-	// need to flip order of the rows:
-	int rpi = height;
-	for (int i=0 ; i<height ; i++)
-		row_pointers[--rpi] = p + i*width*nChannels*sizeof(GLubyte);
-	png_read_image(png_ptr, row_pointers);
-	delete [] row_pointers;
+	allocateImage(height, width, nChannels);
+	// Read row by row (flipping their order) so that each can be reported
+	// as soon as it is final: at once unless the image is interlaced, in
+	// which case only on the last pass.
+	int nPasses = png_set_interlace_handling(png_ptr);
+	png_read_update_info(png_ptr, info_ptr);
+	for (int pass=0 ; pass<nPasses ; pass++)
+		for (int i=0 ; i<height ; i++)
+		{
+			int row = height - 1 - i;
+			png_read_row(png_ptr, theImage->getPlane(row).data, NULL);
+			if (pass == nPasses-1)
+				reportRowsDecoded(row, 1);
+		}
 	png_read_end(png_ptr, (png_infop)NULL);
 	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
 	return true;
@@ -12,7 +12,8 @@
 class PNGImageReader : public ImageReader
 {
 public:
-	PNGImageReader(std::string fileName);
+	PNGImageReader(std::string fileName,
+		const ImageDestination* destination=NULL);
 
 protected:
 	PNGImageReader(const PNGImageReader& s); // cannot use the copy constructor
@@ -4,6 +4,7 @@
 //  Documentation on use:
 //      http://people.eecs.ku.edu/~miller/Courses/ToolDoc/ImageReader.html
 
+#include <algorithm>
 #include <iomanip>
 
 #include "TGAImageReader.h"
@@ -16,8 +17,9 @@ TGAImageReader::TGAImageReader(const TGAImageReader& t) : ImageReader(t)
 
 // Here are the supported constructors
 
-TGAImageReader::TGAImageReader(std::string fileName) :
-	ImageReader(fileName)
+TGAImageReader::TGAImageReader(std::string fileName,
+		const ImageDestination* destination) :
+	ImageReader(fileName, destination)
 {
 	readImage();
 }
@@ -147,8 +149,7 @@ bool TGAImageReader::read()
 		return false;
 	}
 
-	theImage = new cryph::Packed3DArray<GLubyte>
-								(nRows, nCols, nChannels);
+	allocateImage(nRows, nCols, nChannels);
 	unsigned char* imageData = theImage->getModifiableData();
 	getData (fp, size, imageBits, imageData);
     fclose (fp);
@@ -161,14 +162,8 @@ bool TGAImageReader::read()
 		for (int i=0 ; i<nRowsToSwap ; i++)
 		{
 			// swap row 'i' with row 'm'
-			for (int j=0 ; j<nCols ; j++)
-				for (int k=0 ; k<nChannels ; k++)
-				{
-					GLubyte from_i = theImage->getDataElement(i,j,k);
-					GLubyte from_m = theImage->getDataElement(m,j,k);
-					theImage->setDataElement(i,j,k,from_m);
-					theImage->setDataElement(m,j,k,from_i);
-				}
+			cryph::Packed3DArraySpan<GLubyte> row_i = theImage->getPlane(i);
+			std::swap_ranges(row_i.begin(), row_i.end(), theImage->getPlane(m).begin());
 			m--;
 		}
 	}
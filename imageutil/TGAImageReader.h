@@ -12,7 +12,8 @@
 class TGAImageReader : public ImageReader
 {
 public:
-	TGAImageReader(std::string fileName);
+	TGAImageReader(std::string fileName,
+		const ImageDestination* destination=NULL);
 
 protected:
 	TGAImageReader(const TGAImageReader& s); // cannot use the copy constructor
@@ -15,13 +15,16 @@ static const char MULTIDIGIT_NUMERIC_COMMAND_PARAMETER_END   = '$';
 static const char SINGLEDIGIT_NUMERIC_COMMAND_PARAMETER_FLAG   = '@';
 
 Controller::Controller(const std::string& name, int glutRCFlags) :
-	scaleFraction(1.1), scaleIncrement(0.1),
-	mouseMotionIsRotate(false), mouseMotionIsTranslate(false),
+	glClearFlags(GL_COLOR_BUFFER_BIT),
 	// Viewport
-	vpWidth(-1), vpHeight(1), doubleBuffering(false), glClearFlags(GL_COLOR_BUFFER_BIT),
+	vpWidth(-1), vpHeight(1), doubleBuffering(false),
+	scaleFraction(1.1), scaleIncrement(0.1),
+	mouseMotionIsRotate(false), mouseMotionIsTranslate(false), mouseMotionIsSelect(false),
+	selectionIsRectangle(false),
 	commandChar(NO_CHAR), lastNonNumericKeyboardChar(NO_CHAR),
 	parsingMultiDigitCommandParameter(false), parsingSingleDigitCommandParameter(false),
-	commandParameter(0)
+	commandParameter(0),
+	animating(false), animationGeneration(0), animationStart(0), animationDuration(0.0)
 {
 	curController = this;
 	
@@ -51,6 +54,33 @@ void Controller::addModel(ModelView* m)
 	updateMCBoundingBox(m);
 }
 
+void Controller::animationTick(int generation)
+{
+	if (!animating || (generation != animationGeneration))
+		return;
+	double t = 1.0;
+	if (animationDuration > 0.0)
+		t = (glutGet(GLUT_ELAPSED_TIME) - animationStart) / (1000.0 * animationDuration);
+	if (t >= 1.0)
+	{
+		t = 1.0;
+		animating = false;
+	}
+	else
+		glutTimerFunc(ANIMATION_TIMER_INTERVAL, animationTimerCB, generation);
+	// ease in and out
+	double eased = t * t * (3.0 - 2.0*t);
+	for (std::vector<ModelView*>::iterator it=models.begin() ; it<models.end() ; it++)
+		(*it)->animate(eased);
+	glutPostRedisplay();
+}
+
+void Controller::animationTimerCB(int value) // CLASS METHOD
+{
+	if (curController != NULL)
+		curController->animationTick(value);
+}
+
 bool Controller::checkForErrors(std::ostream& os, const std::string& context)
 	// CLASS METHOD
 {
@@ -81,6 +111,25 @@ void Controller::checkForPick(int x, int y)
 	}
 }
 
+void Controller::checkForSelection()
+{
+	// a rectangle is given by its first and last corners; a lasso by all
+	// the positions the mouse moved through
+	if (selectionIsRectangle && (selectionPath.size() > 4))
+		selectionPath.erase(selectionPath.begin()+2, selectionPath.end()-2);
+	int nVertices = selectionPath.size() / 2;
+	if (nVertices < (selectionIsRectangle ? 2 : 3))
+		return;
+
+	int which = 0;
+	for (std::vector<ModelView*>::iterator it=models.begin() ; it<models.end() ; it++)
+	{
+		if (visible[which++])
+			(*it)->selectRegion(&selectionPath[0], nVertices);
+	}
+	glutPostRedisplay();
+}
+
 int Controller::createWindow(const std::string& windowTitle, int glutRCFlags) // CLASS METHOD
 {
 	// The following calls enforce use of only non-deprecated functionality.
@@ -157,6 +206,9 @@ void Controller::handleDisplay()
 	// clear the frame buffer
 	glClear(glClearFlags);
 
+	// one upload of the view state for all of the models
+	ModelView::updateViewUniformBlock();
+
 	// draw the collection of models
 	int which = 0;
 	for (std::vector<ModelView*>::iterator it=models.begin() ; it<models.end() ; it++)
@@ -298,14 +350,35 @@ void Controller::handleMouseFunc(int button, int state, int x, int y)
 	}
 	else if (button == GLUT_LEFT_BUTTON)
 	{
-		mouseMotionIsTranslate = ((glutGetModifiers() & GLUT_ACTIVE_SHIFT) != 0);
-		mouseMotionIsRotate = !mouseMotionIsTranslate;
+		int modifiers = glutGetModifiers();
+		bool shiftDown = ((modifiers & GLUT_ACTIVE_SHIFT) != 0);
+		double ldsX, ldsY;
+		screenXYToLDS(x, y, ldsX, ldsY);
 		if (state == GLUT_DOWN)
 		{
+			// CTRL-drag: lasso select; CTRL-SHIFT-drag: rectangle select
+			mouseMotionIsSelect = ((modifiers & GLUT_ACTIVE_CTRL) != 0);
+			selectionIsRectangle = mouseMotionIsSelect && shiftDown;
+			mouseMotionIsTranslate = !mouseMotionIsSelect && shiftDown;
+			mouseMotionIsRotate = !mouseMotionIsSelect && !shiftDown;
 			screenBaseX = x; screenBaseY = y;
+			selectionPath.clear();
+			if (mouseMotionIsSelect)
+			{
+				selectionPath.push_back(ldsX);
+				selectionPath.push_back(ldsY);
+			}
 		}
 		else
-			mouseMotionIsTranslate = mouseMotionIsRotate = false;
+		{
+			if (mouseMotionIsSelect)
+			{
+				selectionPath.push_back(ldsX);
+				selectionPath.push_back(ldsY);
+				checkForSelection();
+			}
+			mouseMotionIsTranslate = mouseMotionIsRotate = mouseMotionIsSelect = false;
+		}
 	}
 	else if ((button == GLUT_RIGHT_BUTTON) && (state == GLUT_UP))
 		checkForPick(x,y);
@@ -334,11 +407,30 @@ void Controller::handleMouseMotion(int x, int y)
 		double screenRotX = pixelsToDegrees * dy;
 		ModelView::addToGlobalRotationDegrees(screenRotX, screenRotY, 0.0);
 	}
+	else if (mouseMotionIsSelect)
+	{
+		// the view does not change while a selection region is dragged out
+		double ldsX, ldsY;
+		screenXYToLDS(x, y, ldsX, ldsY);
+		selectionPath.push_back(ldsX);
+		selectionPath.push_back(ldsY);
+		return;
+	}
 	glutPostRedisplay();
 }
 
 void Controller::handleMousePassiveMotion(int x, int y)
 {
+	double ldsX, ldsY;
+	screenXYToLDS(x, y, ldsX, ldsY);
+
+	int which = 0;
+	for (std::vector<ModelView*>::iterator it=models.begin() ; it<models.end() ; it++)
+	{
+		if (visible[which++])
+			if ((*it)->hovered(ldsX, ldsY))
+				return;
+	}
 }
 
 void Controller::handleReshape()
@@ -413,6 +505,7 @@ void Controller::printKeyboardKeyList()
 	std::cout << "Controller:\n";
 	std::cout << "? - produce this list\n";
 	std::cout << "\tO, P, Q: set Orthogonal, Perspective, obliQue\n";
+	std::cout << "\tCTRL-drag: lasso select; CTRL-SHIFT-drag: rectangle select\n";
 	std::cout << "\tDelete (D) and Visibility (V): D" << SINGLEDIGIT_NUMERIC_COMMAND_PARAMETER_FLAG
 	          << "i -OR- D" << MULTIDIGIT_NUMERIC_COMMAND_PARAMETER_START << "iii"
 	          << MULTIDIGIT_NUMERIC_COMMAND_PARAMETER_END << '\n';
@@ -508,6 +601,7 @@ void Controller::reshapeCB(int width, int height)
 {
 	Controller::curController->vpWidth = width;
 	Controller::curController->vpHeight = height;
+	ModelView::viewChanged(); // the aspect ratio may have changed
 	Controller::curController->handleReshape();
 }
 
@@ -526,6 +620,15 @@ void Controller::specialKeyCB(int key, int x, int y)
 		Controller::curController->handleSpecialKey(key, x, y);
 }
 
+void Controller::startAnimation(double durationSeconds)
+{
+	animating = true;
+	animationStart = glutGet(GLUT_ELAPSED_TIME);
+	animationDuration = durationSeconds;
+	// any timer callback of an earlier animation will now be ignored
+	glutTimerFunc(0, animationTimerCB, ++animationGeneration);
+}
+
 void Controller::toggleVisibility(int which)
 {
 	if ((which >= 0) && (which < models.size()))
@@ -554,4 +657,5 @@ void Controller::updateMCBoundingBox(ModelView* m)
 	}
 	else // use this model to initialize the bounding box
 		m->getMCBoundingBox(overallMCBoundingBox);
+	ModelView::viewChanged();
 }
@@ -33,6 +33,11 @@ public:
 	void getOverallMCBoundingBox(double* xyzLimits) const;
 	virtual void getMCRegionOfInterest(double* xyzLimits) const;
 	virtual void printKeyboardKeyList();
+	// Calls animate(t) on every model and redisplays about every
+	// ANIMATION_TIMER_INTERVAL milliseconds until t reaches 1. Starting a new
+	// animation ends any current one.
+	void startAnimation(double durationSeconds);
+	bool isAnimating() const { return animating; }
 
 	// 3. CLASS METHODS
 	static bool checkForErrors(std::ostream& os, const std::string& context);
@@ -45,6 +50,7 @@ protected:
 	std::vector<bool> visible;
 
 	void checkForPick(int x, int y);
+	void checkForSelection();
 	virtual void establishInitialCallbacksForRC();
 	virtual void handleDisplay();
 	virtual void handleKeyboard(unsigned char key, int x, int y);
@@ -68,8 +74,11 @@ private:
 	double scaleFraction, scaleIncrement;
 
 	// mouse state
-	bool mouseMotionIsRotate, mouseMotionIsTranslate;
+	bool mouseMotionIsRotate, mouseMotionIsTranslate, mouseMotionIsSelect;
 	int screenBaseX, screenBaseY;
+	// LDS (x,y) vertices of a selection region being dragged out
+	bool selectionIsRectangle;
+	std::vector<double> selectionPath;
 
 	// for handling keyboard commands with numeric operands
 	unsigned char commandChar, lastNonNumericKeyboardChar;
@@ -77,8 +86,18 @@ private:
 	bool parsingSingleDigitCommandParameter;
 	int commandParameter;
 
+	// animation clock (GLUT_ELAPSED_TIME, milliseconds)
+	bool animating;
+	int animationGeneration; // identifies the timer callbacks of the current animation
+	int animationStart;
+	double animationDuration;
+
+	void animationTick(int generation);
 	void updateMCBoundingBox(ModelView* m);
 
+	static void animationTimerCB(int value);
+	static const int ANIMATION_TIMER_INTERVAL = 16; // milliseconds
+
 	static Controller* curController;
 
 	static void displayCB();
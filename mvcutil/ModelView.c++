@@ -1,5 +1,7 @@
 // ModelView.c++ - abstract base class for models managed by a Controller
 
+#include <cmath>
+#include <cstring>
 #include <iostream>
 
 #include <GL/freeglut.h>
@@ -40,6 +42,20 @@ cryph::Matrix4x4 ModelView::dynamic(1,0,0,0 , 0,1,0,0 , 0,0,1,0, 0,0,0,1);
 cryph::Matrix4x4 ModelView::lookAtMatrix;
 cryph::Matrix4x4 ModelView::mc_ec_full;
 cryph::Matrix4x4 ModelView::ec_lds;
+GLuint ModelView::viewBlockBuffer = 0;
+unsigned long ModelView::viewBlockVersion = 0;
+// The view state is recomputed when "viewVersion" moves past the version
+// it was computed for.
+unsigned long ModelView::viewVersion = 1;
+ModelView::ViewState ModelView::viewState; // version 0: not yet computed
+
+// std140 layout of the ViewTransformation uniform block
+struct ViewBlock
+{
+	float mc_ec[16], ec_lds[16]; // column-major
+	float xFactor, yFactor;
+	float pad[2];
+};
 
 // EXPERIMENTAL:
 // 1) Translating dynamic rotations to eye-center-up
@@ -97,6 +113,7 @@ void ModelView::addToGlobalPan(double dxInLDS, double dyInLDS, double dzInLDS)
 			cryph::AffVector(dxInEC, dyInEC, dzInEC));
 		dynamic = trans * dynamic;
 	}
+	viewChanged();
 }
 
 void ModelView::addToGlobalRotationDegrees(double rx, double ry, double rz)
@@ -105,14 +122,79 @@ void ModelView::addToGlobalRotationDegrees(double rx, double ry, double rz)
 	cryph::Matrix4x4 ryM = cryph::Matrix4x4::yRotationDegrees(ry);
 	cryph::Matrix4x4 rzM = cryph::Matrix4x4::zRotationDegrees(rz);
 	dynamic = rxM * ryM * rzM * dynamic;
+	viewChanged();
 }
 
 void ModelView::addToGlobalZoom(double increment)
 {
 	if ((scale+increment) > 0.0)
 		scale += increment;
+	viewChanged();
+}
+
+void ModelView::bindUniformBlock(GLuint glslProgram, const std::string& name, GLuint binding)
+{
+	GLuint block = glGetUniformBlockIndex(glslProgram, name.c_str());
+	if (block == GL_INVALID_INDEX)
+		std::cerr << "Could not locate uniform block: '" << name << "'\n";
+	else
+		glUniformBlockBinding(glslProgram, block, binding);
+}
+
+void ModelView::computeViewState()
+{
+	double preTransDist = fractionOfDistEyeCenterToCenterOfRotation * curEC.distEyeCenter;
+	cryph::Matrix4x4 preTrans = cryph::Matrix4x4::translation(
+		cryph::AffVector(0.0, 0.0, preTransDist));
+	cryph::Matrix4x4 postTrans = cryph::Matrix4x4::translation(
+		cryph::AffVector(0.0, 0.0, -preTransDist));
+	cryph::Matrix4x4 post_dynamic_pre = postTrans * dynamic * preTrans;
+
+	lookAtMatrix = cryph::Matrix4x4::lookAt(curEC.eye, curEC.center, curEC.up);
+	if (ModelView::translateDynamicRotationToEyeUp)
+	{
+		if (!ModelView::haveOriginalVOM)
+		{
+			originalVOM = cryph::Matrix4x4::lookAt(
+						curEC.eye, curEC.center, curEC.up);
+			haveOriginalVOM = true;
+		}
+		cryph::Matrix4x4 vom = post_dynamic_pre * originalVOM;
+		double m[16];
+		vom.extractColMajor(m);
+		cryph::AffVector wHat(m[2],m[6],m[10]);
+		curEC.eye = curEC.center + curEC.distEyeCenter*wHat;
+		curEC.up = cryph::AffVector(m[1],m[5],m[9]);
+		mc_ec_full = lookAtMatrix;
+	}
+	else
+		mc_ec_full = post_dynamic_pre * lookAtMatrix;
+
+	setProjectionTransformation();
+
+	cryph::Matrix4x4 mc_lds = ec_lds * mc_ec_full;
+	mc_ec_full.extractColMajor(viewState.mc_ec);
+	ec_lds.extractColMajor(viewState.ec_lds);
+	mc_lds.extractColMajor(viewState.mc_lds);
+	// Each plane of the view volume is the bottom row of mc_lds plus or
+	// minus one of the others (Gribb and Hartmann).
+	double m[16];
+	mc_lds.extractRowMajor(m);
+	for (int i=0 ; i<6 ; i++)
+	{
+		double* plane = viewState.frustumPlanes[i];
+		double sign = ((i % 2) == 0) ? 1.0 : -1.0;
+		for (int j=0 ; j<4 ; j++)
+			plane[j] = m[12+j] + sign*m[4*(i/2)+j];
+		double length = sqrt(plane[0]*plane[0] + plane[1]*plane[1] + plane[2]*plane[2]);
+		if (length > 0.0)
+			for (int j=0 ; j<4 ; j++)
+				plane[j] /= length;
+	}
+	viewState.version = viewVersion;
 }
 
+
 void ModelView::computeScaleTrans(float* scaleTransF) // USED FOR 2D SCENES
 {
 	Controller* c = Controller::getCurrentController();
@@ -166,40 +248,19 @@ void ModelView::computeScaleTrans(float* scaleTransF) // USED FOR 2D SCENES
 void ModelView::getMatrices(cryph::Matrix4x4& mc_ec_fullOut,
 							cryph::Matrix4x4& ec_ldsOut)
 {
-	double preTransDist = fractionOfDistEyeCenterToCenterOfRotation * curEC.distEyeCenter;
-	cryph::Matrix4x4 preTrans = cryph::Matrix4x4::translation(
-		cryph::AffVector(0.0, 0.0, preTransDist));
-	cryph::Matrix4x4 postTrans = cryph::Matrix4x4::translation(
-		cryph::AffVector(0.0, 0.0, -preTransDist));
-	cryph::Matrix4x4 post_dynamic_pre = postTrans * dynamic * preTrans;
-
-	lookAtMatrix = cryph::Matrix4x4::lookAt(curEC.eye, curEC.center, curEC.up);
-	if (ModelView::translateDynamicRotationToEyeUp)
-	{
-		if (!ModelView::haveOriginalVOM)
-		{
-			originalVOM = cryph::Matrix4x4::lookAt(
-						curEC.eye, curEC.center, curEC.up);
-			haveOriginalVOM = true;
-		}
-		cryph::Matrix4x4 vom = post_dynamic_pre * originalVOM;
-		double m[16];
-		vom.extractColMajor(m);
-		cryph::AffVector wHat(m[2],m[6],m[10]);
-		curEC.eye = curEC.center + curEC.distEyeCenter*wHat;
-		curEC.up = cryph::AffVector(m[1],m[5],m[9]);
-		mc_ec_full = lookAtMatrix;
-	}
-	else
-		mc_ec_full = post_dynamic_pre * lookAtMatrix;
-
-	setProjectionTransformation();
-
-	// Return the two final matrices
+	if (viewState.version != viewVersion)
+		computeViewState();
 	mc_ec_fullOut = mc_ec_full;
 	ec_ldsOut = ec_lds;
 }
 
+const ModelView::ViewState& ModelView::getViewState()
+{
+	if (viewState.version != viewVersion)
+		computeViewState();
+	return viewState;
+}
+
 void ModelView::handleCommand(unsigned char key, double ldsX, double ldsY)
 {
 }
@@ -252,17 +313,20 @@ void ModelView::resetGlobalDynamic()
 	mcPanVector2D = cryph::AffVector(0,0,0);
 	dynamic = cryph::Matrix4x4::IdentityMatrix;
 	curEC = origEC;
+	viewChanged();
 }
 
 void ModelView::resetGlobalZoom()
 {
 	scale = 1.0;
-}	
+	viewChanged();
+}
 
 void ModelView::scaleGlobalZoom(double multiplier)
 {
 	if (multiplier > 0.0)
 		scale *= multiplier;
+	viewChanged();
 }
 
 void ModelView::set_ecDeltas()
@@ -335,21 +399,25 @@ void ModelView::setEyeCenterUp(cryph::AffPoint E, cryph::AffPoint C, cryph::AffV
 void ModelView::setFractionalDistEyeToCenterOfRotation(double f)
 {
 	fractionOfDistEyeCenterToCenterOfRotation = f;
+	viewChanged();
 }
 
 void ModelView::setObliqueProjectionDirection(const cryph::AffVector& dir)
 {
 	ModelView::obliqueProjectionDir = dir;
+	viewChanged();
 }
 
 void ModelView::setProjection(ProjectionType pType)
 {
 	projType = pType;
+	viewChanged();
 }
 
 void ModelView::setProjectionPlaneZ(double zppIn)
 {
 	zpp = zppIn;
+	viewChanged();
 }
 
 // Following is very roughly the 3D counterpart of the 2D "computeScaleTrans"
@@ -377,3 +445,41 @@ void ModelView::setProjectionTransformation()
 			ModelView::obliqueProjectionDir);
 	ecDeltaZ = zmax - zmin;
 }
+
+void ModelView::updateViewUniformBlock()
+{
+	const ViewState& view = getViewState();
+	if ((viewBlockBuffer == 0) || (viewBlockVersion != view.version))
+	{
+		ViewBlock block;
+		memcpy(block.mc_ec, view.mc_ec, sizeof(block.mc_ec));
+		memcpy(block.ec_lds, view.ec_lds, sizeof(block.ec_lds));
+		// Glyphs drawn in LDS would be stretched along the longer side of the
+		// viewport, so one of these scales them back (the other is 1).
+		block.xFactor = block.yFactor = 1.0;
+		if (aspectRatioPreservationEnabled)
+		{
+			float ratio = ecDeltaY / ecDeltaX;
+			if (ratio > 1.0)
+				block.yFactor = 1.0 / ratio;
+			else
+				block.xFactor = ratio;
+		}
+		block.pad[0] = block.pad[1] = 0.0;
+
+		if (viewBlockBuffer == 0)
+		{
+			glGenBuffers(1, &viewBlockBuffer);
+			glBindBuffer(GL_UNIFORM_BUFFER, viewBlockBuffer);
+			glBufferData(GL_UNIFORM_BUFFER, sizeof(block), &block, GL_DYNAMIC_DRAW);
+		}
+		else
+		{
+			glBindBuffer(GL_UNIFORM_BUFFER, viewBlockBuffer);
+			glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &block);
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		viewBlockVersion = view.version;
+	}
+	glBindBufferBase(GL_UNIFORM_BUFFER, VIEW_BLOCK_BINDING, viewBlockBuffer);
+}
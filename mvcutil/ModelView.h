@@ -22,7 +22,15 @@ public:
 	virtual void handleCommand(unsigned char key, int num, double ldsX, double ldsY);
 	virtual void handleSpecialKey(int key, double ldsX, double ldsY) { }
 	virtual bool picked(double ldsX, double ldsY) { return false; }
+	// called as the mouse moves with no buttons pressed
+	virtual bool hovered(double ldsX, double ldsY) { return false; }
+	// ldsXY holds the nVertices (x,y) vertices of a region dragged out by the
+	// user: 2 ==> opposite corners of a rectangle; more ==> a lasso polygon
+	virtual void selectRegion(const double* ldsXY, int nVertices) { }
 	virtual void render() = 0;
+	// called on each tick of an animation started by Controller::startAnimation;
+	// t (already eased) runs from 0 to 1 and is exactly 1 on the last tick
+	virtual void animate(double t) { }
 
 	// common 3D global (i.e., applies to entire scene) dynamic viewing requests
 	static void addToGlobalPan(double dxInLDS, double dyInLDS, double dzInLDS);
@@ -31,7 +39,8 @@ public:
 	static void resetGlobalDynamic(); // rotation and pan
 	static void resetGlobalZoom();
 	static void scaleGlobalZoom(double multiplier); // scale *= multiplier
-	static void setAspectRatioPreservationEnabled(bool b) { aspectRatioPreservationEnabled = b; }
+	static void setAspectRatioPreservationEnabled(bool b)
+		{ aspectRatioPreservationEnabled = b; viewChanged(); }
 	static void setEyeCenterUp(cryph::AffPoint E, cryph::AffPoint C, cryph::AffVector up);
 	// setFractionalDistEyeToCenterOfRotation: 0=>about eye; 1=>about center of attention
 	static void setFractionalDistEyeToCenterOfRotation(double f);
@@ -40,6 +49,35 @@ public:
 	static void setProjectionPlaneZ(double zppIn);
 	static void setUseGlobalZoomIn2D(bool b) { useGlobalZoomIn_computeScaleTrans = b; }
 
+	// The matrices of the current view, computed once each time the view
+	// changes and shared by all models. "version" increases with each
+	// change, so anything derived from the view can tell when it is stale.
+	struct ViewState
+	{
+		unsigned long version;
+		float mc_ec[16], ec_lds[16], mc_lds[16]; // column-major
+		// left, right, bottom, top, near, far planes of the view volume in
+		// model coordinates: (a, b, c, d) with ax+by+cz+d >= 0 inside
+		double frustumPlanes[6][4];
+	};
+	static const ViewState& getViewState();
+	// The methods above call this themselves. Anything else that changes
+	// what the view depends on (the viewport, the region of interest or
+	// the public fields below) must call it.
+	static void viewChanged() { viewVersion++; }
+
+	// The view state shared by all models, kept in a uniform buffer bound
+	// to VIEW_BLOCK_BINDING that shaders declare as:
+	//     layout (std140) uniform ViewTransformation
+	//     {
+	//         mat4 mc_ec, ec_lds;
+	//         float xFactor, yFactor; // keep glyphs drawn in LDS square
+	//     };
+	// Controller::handleDisplay updates it once per frame before any model
+	// renders; anything else that renders must do so first.
+	static const GLuint VIEW_BLOCK_BINDING = 0;
+	static void updateViewUniformBlock();
+
 	virtual void printKeyboardKeyList(bool firstCall) const;
 protected:
 	GLenum polygonMode;
@@ -56,6 +94,8 @@ protected:
 	// "pp": "per-primitive"; "pv": "per-vertex"
 	static GLint ppUniformLocation(GLuint glslProgram, const std::string& name);
 	static GLint pvAttribLocation(GLuint glslProgram, const std::string& name);
+	// binds the uniform block "name" of glslProgram to the given binding point
+	static void bindUniformBlock(GLuint glslProgram, const std::string& name, GLuint binding);
 	
 public:
 	static double mcXMinRegionOfInterest, mcXMaxRegionOfInterest,
@@ -94,6 +134,12 @@ public:
 	static cryph::Matrix4x4 lookAtMatrix;
 	static cryph::Matrix4x4 mc_ec_full; // = rotation * lookAtMatrix
 	static cryph::Matrix4x4 ec_lds; // wv * proj
+	static GLuint viewBlockBuffer; // see updateViewUniformBlock
+	static unsigned long viewBlockVersion; // view uploaded to viewBlockBuffer
+	static unsigned long viewVersion;
+	static ViewState viewState; // as of viewState.version
+
+	static void computeViewState();
 
 	static void establishLightsAndView();
 	static void set_ecDeltas();